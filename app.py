@@ -40,6 +40,20 @@ def parse_txt_file(uploaded_file):
         
     return points
 
+def generate_points(n, metric):
+    """Random cities in a 1000x1000 square, or as (latitude, longitude) for geographic metrics."""
+    if metric not in ("geo", "haversine"):
+        return [(random.uniform(0, 1000), random.uniform(0, 1000)) for _ in range(n)]
+
+    points = []
+    for _ in range(n):
+        lat, lon = random.uniform(-60, 70), random.uniform(-180, 180)
+        if metric == "geo":
+            # TSPLIB GEO coordinates are DDD.MM (degrees, then minutes)
+            lat, lon = [int(v) + (v - int(v)) * 0.6 for v in (lat, lon)]
+        points.append((lat, lon))
+    return points
+
 with st.sidebar:
     st.header("1. Problem Setup")
     
@@ -102,11 +116,38 @@ with st.sidebar:
         smo_ll = st.number_input("SMO Local Limit", min_value=1, value=20)
         smo_gl = st.number_input("SMO Global Limit", min_value=1, value=20)
         smo_pr = st.slider("SMO Perturbation Rate (pr)", 0.0, 1.0, 0.1)
+        smo_kmeans_pp = st.checkbox("SMO k-means++ Initialization", value=False)
+        smo_lloyd = st.number_input(
+            "SMO Lloyd Refinement Interval", min_value=0, value=0,
+            help="Refine leaders with a few k-means steps every N iterations (0 = off)."
+        )
+        smo_sample = st.number_input(
+            "SMO Fitness Sample Size", min_value=0, value=0,
+            help="0 evaluates every candidate on all points; a positive value "
+                 "scores candidates on a weighted sample of that many points."
+        )
         
         aco_alpha = st.slider("ACO Alpha (τ weight)", 0.1, 10.0, 1.0, 0.1)
         aco_beta = st.slider("ACO Beta (η weight)", 0.1, 10.0, 5.0, 0.1)
         aco_rho = st.slider("ACO Rho (Evaporation)", 0.01, 1.0, 0.5, 0.01)
         aco_Q = st.number_input("ACO Q (Pheromone)", min_value=1, value=100)
+        aco_islands = st.number_input("ACO Islands (parallel colonies)", min_value=1, value=1)
+        aco_migration = st.number_input("ACO Migration Interval", min_value=1, value=25)
+        worker_processes = st.number_input(
+            "Routing Worker Processes", min_value=0, value=0,
+            help="Route clusters in separate processes (0 = in this process)."
+        )
+        improve_routes = st.checkbox(
+            "Inter-route Improvement", value=False,
+            help="After routing, move cities between neighboring salesmen's routes."
+        )
+
+        metric = st.selectbox(
+            "Distance Metric",
+            ("euclidean", "manhattan", "euc_2d", "att", "geo", "haversine"),
+            help="geo and haversine expect (latitude, longitude) coordinates."
+        )
+        precision = st.selectbox("Precision", ("double", "float"))
 
     run_button = st.button(
         "Run Hybrid Solver", type="primary", use_container_width=True
@@ -115,10 +156,7 @@ with st.sidebar:
 
 if run_button:
     if input_method == "Randomly Generate":
-        points = [
-            (random.uniform(0, 1000), random.uniform(0, 1000)) 
-            for _ in range(n_cities)
-        ]
+        points = generate_points(n_cities, metric)
         
     if not points:
         st.error("No points to process. Upload a file or select 'Randomly Generate'.")
@@ -147,7 +185,17 @@ if run_button:
                 aco_alpha=aco_alpha,
                 aco_beta=aco_beta,
                 aco_rho=aco_rho,
-                aco_Q=aco_Q
+                aco_Q=aco_Q,
+                aco_islands=aco_islands,
+                aco_migration_interval=aco_migration,
+                smo_sample_size=smo_sample,
+                smo_kmeans_pp=smo_kmeans_pp,
+                smo_lloyd_interval=smo_lloyd,
+                improve_routes=improve_routes,
+                worker_processes=worker_processes,
+
+                metric=metric,
+                precision=precision
             )
             
             # Run the solver
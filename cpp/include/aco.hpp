@@ -3,21 +3,30 @@
 #define ACO_H
 
 #include "graph.hpp"
+#include "checkpoint.hpp"
+#include <functional>
+#include <memory>
 #include <vector>
 #include <random>
 
+template <typename Metric = EuclideanMetric, typename T = double>
 class ACO {
+public:
+    typedef std::pair<T,T> Point;
+
 private:
-    Graph graph;
+    std::shared_ptr<const Graph<Metric, T>> owned_graph; // only when built from points
+    const Graph<Metric, T>& graph;
     int num_ants, num_cities;
     double alpha, beta, rho, Q;
 
-    std::vector<std::vector<double>> pher_mat;
+    std::vector<std::vector<T>> pher_mat;
     std::vector<std::vector<int>> tours;
     std::vector<double> tour_length;
 
     std::vector<int> best_tour;
     double best_length;
+    int iterations_done;
 
     std::mt19937 rng;
 
@@ -26,13 +35,25 @@ private:
     void evaporate_pher();
     void deposit_pher(const std::vector<int>& path, double length);
     void update_pher();
+    void init();
 
 public:
-    ACO(const std::vector<std::pair<double,double>>& pts, int ants,
+    ACO(const std::vector<Point>& pts, int ants,
         double alpha=1.0, double beta=5.0, double rho=0.5, double Q=100.0);                        
-    void run(int iterations);   
+    // Does not copy `g`: it must outlive the colony and may be shared by
+    // several colonies, which only read it.
+    ACO(const Graph<Metric, T>& g, int ants,
+        double alpha=1.0, double beta=5.0, double rho=0.5, double Q=100.0);
+    // Runs up to `iterations` in total, counting any restored from a checkpoint.
+    void run(int iterations, const std::function<void()>& on_iteration = std::function<void()>());
+    void step();
+    void accept_migrant(const std::vector<int>& tour, double length);
     std::vector<int> final_route() const;
     double best_distance() const;
+    int iterations() const;
+
+    void save(CheckpointWriter& out) const;
+    void load(CheckpointReader& in);
 };
 
 #endif
@@ -0,0 +1,174 @@
+#pragma once
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compact host-endian binary format used for solver checkpoints and the
+// instance cache. Writers append into an in-memory buffer (cheap, done on the
+// solver thread); the buffer is then flushed to disk separately. Readers
+// either wrap a memory range or memory-map a file; arrays and blobs can be
+// viewed in place instead of being copied out of the mapping.
+
+const char CHECKPOINT_MAGIC[8] = {'M', 'T', 'S', 'P', 'C', 'K', 'P', 'T'};
+const uint32_t CHECKPOINT_VERSION = 2;
+
+// 64-bit FNV-1a, used to tie a checkpoint to the instance it was taken on.
+inline uint64_t fnv1a(const void* data, size_t len, uint64_t h = 14695981039346656037ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Immutable byte range (e.g. serialized solver state) that is cheap to copy.
+// It either owns its bytes or points into memory kept alive by `owner`, such
+// as a mapped CheckpointReader.
+class CheckpointBlob {
+public:
+    CheckpointBlob() : m_data(nullptr), m_size(0) {}
+
+    explicit CheckpointBlob(std::vector<char> bytes)
+        : m_size(bytes.size())
+    {
+        std::shared_ptr<std::vector<char>> owned = std::make_shared<std::vector<char>>();
+        owned->swap(bytes);
+        m_data = owned->data();
+        m_owner = owned;
+    }
+
+    CheckpointBlob(const std::shared_ptr<const void>& owner, const char* data, size_t size)
+        : m_owner(owner), m_data(data), m_size(size) {}
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    std::shared_ptr<const void> m_owner;
+    const char* m_data;
+    size_t m_size;
+};
+
+class CheckpointWriter {
+public:
+    template <typename V>
+    void put(const V& v) {
+        const char* p = reinterpret_cast<const char*>(&v);
+        m_buf.insert(m_buf.end(), p, p + sizeof(V));
+    }
+
+    template <typename V>
+    void putVector(const std::vector<V>& v) {
+        put<uint64_t>(v.size());
+        if (!v.empty()) {
+            const char* p = reinterpret_cast<const char*>(v.data());
+            m_buf.insert(m_buf.end(), p, p + v.size() * sizeof(V));
+        }
+    }
+
+    template <typename V>
+    void putPoints(const std::vector<std::pair<V,V>>& v) {
+        put<uint64_t>(v.size());
+        for (const auto& p : v) {
+            put(p.first);
+            put(p.second);
+        }
+    }
+
+    // Raw array with no length prefix, aligned so a mapped reader can view it in place.
+    template <typename V>
+    void putArray(const V* data, size_t count) {
+        align(alignof(V));
+        const char* p = reinterpret_cast<const char*>(data);
+        m_buf.insert(m_buf.end(), p, p + count * sizeof(V));
+    }
+
+    void align(size_t alignment);
+    void putString(const std::string& s);
+    void putBlob(const std::vector<char>& blob);
+    void putBlob(const CheckpointBlob& blob);
+
+    const std::vector<char>& buffer() const { return m_buf; }
+
+    // Writes to `path` via a temporary file and rename, so a crash mid-write
+    // never leaves a truncated checkpoint behind.
+    void writeFile(const std::string& path) const;
+
+private:
+    std::vector<char> m_buf;
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader(const char* data, size_t size);
+    explicit CheckpointReader(const std::string& path);
+    ~CheckpointReader();
+
+    template <typename V>
+    V get() {
+        V v;
+        std::memcpy(&v, take(sizeof(V)), sizeof(V));
+        return v;
+    }
+
+    template <typename V>
+    void getVector(std::vector<V>& v) {
+        uint64_t n = get<uint64_t>();
+        if (n > (m_size - m_pos) / sizeof(V))
+            throw std::runtime_error("Checkpoint is truncated or corrupt");
+        v.resize(n);
+        if (n > 0)
+            std::memcpy(v.data(), take(n * sizeof(V)), n * sizeof(V));
+    }
+
+    template <typename V>
+    void getPoints(std::vector<std::pair<V,V>>& v) {
+        uint64_t n = get<uint64_t>();
+        if (n > (m_size - m_pos) / (2 * sizeof(V)))
+            throw std::runtime_error("Checkpoint is truncated or corrupt");
+        v.resize(n);
+        for (auto& p : v) {
+            p.first = get<V>();
+            p.second = get<V>();
+        }
+    }
+
+    // Pointer to `count` elements written with putArray, without copying.
+    // Valid only as long as this reader is alive.
+    template <typename V>
+    const V* viewArray(size_t count) {
+        align(alignof(V));
+        if (count > (m_size - m_pos) / sizeof(V))
+            throw std::runtime_error("Checkpoint is truncated or corrupt");
+        return reinterpret_cast<const V*>(take(count * sizeof(V)));
+    }
+
+    void align(size_t alignment);
+    std::string getString();
+    std::vector<char> getBlob();
+    // Blob written with putBlob, without copying; valid while this reader is alive.
+    const char* viewBlob(size_t& size);
+
+private:
+    CheckpointReader(const CheckpointReader&);
+    CheckpointReader& operator=(const CheckpointReader&);
+
+    const char* take(size_t n);
+
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos;
+    void* m_mapping;
+    std::vector<char> m_owned;
+};
+
+#endif
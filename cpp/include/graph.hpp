@@ -2,20 +2,66 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include "metric.hpp"
+#include "checkpoint.hpp"
+#include <memory>
+#include <string>
 #include <vector>
 
+template <typename Metric = EuclideanMetric, typename T = double>
 class Graph{
+public:
+    typedef std::pair<T,T> Point;
+
 private:
-    std::vector<std::vector<double>> dist;
-    std::vector<std::pair<double,double>> Points;
+    std::vector<Point> Points;
+    int n;
+
+    // Row-major n x n matrix and n x num_neighbors lists. They point either
+    // into the *_storage vectors or into a memory-mapped instance cache.
+    std::vector<T> dist_storage;
+    const T* dist;
+    std::vector<int> neighbor_storage;
+    const int* neighbors;
+    int num_neighbors;
+
+    std::pair<T,T> x_bounds;
+    std::pair<T,T> y_bounds;
+    mutable double nn_length; // < 0 until computed
+
+    std::shared_ptr<CheckpointReader> mapping;
+
+    void computeBounds();
+    T distanceOf(int i, int j) const;
+    void rebind(const Graph& other);
+
 public:
-    Graph(const std::vector<std::pair<double,double>>& pts);
+    Graph(const std::vector<Point>& pts, bool compute_dist = true);
+    // Graph over parent's points `subset`, reusing the parent's distances if it has them.
+    Graph(const Graph& parent, const std::vector<int>& subset);
+    Graph(const Graph& other);
+    Graph& operator=(const Graph& other);
     
     void computeDistanceMatrix();
-    double getDistance(int i, int j) const;
-    int size() const;
-    const std::vector<std::pair<double,double>>& getPoints() const;
-    const std::vector<std::vector<double>>& getDist() const;
+    void computeNeighbors(int k);
+    T getDistance(int i, int j) const { return dist[(size_t)i * n + j]; }
+    int size() const { return n; }
+    const std::vector<Point>& getPoints() const;
+    const T* getDist() const;
+    const int* getNeighbors(int i) const { return neighbors + (size_t)i * num_neighbors; }
+    int getNumNeighbors() const { return num_neighbors; }
+    const std::pair<T,T>& getXBounds() const;
+    const std::pair<T,T>& getYBounds() const;
     const double nearest_neighbor_tour_length() const;
+
+    // FNV-1a over the metric, precision and coordinates; identifies the instance.
+    uint64_t contentHash() const;
+
+    // Instance cache: coordinates, bounds, nearest-neighbor tour length,
+    // neighbor lists and (optionally) the distance matrix. loadCache() maps
+    // the file and views the arrays in place; it returns false if the file is
+    // missing, unreadable or was built for different points.
+    bool loadCache(const std::string& path);
+    void saveCache(const std::string& path, bool with_dist) const;
 };
-#endif
\ No newline at end of file
+#endif
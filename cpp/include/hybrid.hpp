@@ -5,11 +5,41 @@
 #include "graph.hpp"
 #include "smo.hpp"
 #include "aco.hpp"
+#include "island_aco.hpp"
+#include "inter_route.hpp"
+#include "checkpoint.hpp"
+#include "process_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
-class Hybrid {
+// Type-erased handle so the (metric, precision) choice is made once, at
+// construction, rather than inside the solver loops.
+class HybridBase {
 public:
+    virtual ~HybridBase() {}
+
+    virtual void run() = 0;
+
+    virtual std::vector<std::vector<int>> getRoutes() const = 0;
+
+    virtual double getTotalLength() const = 0;
+
+    virtual void loadCheckpoint(const std::string& path) = 0;
+
+    virtual void saveCheckpoint(const std::string& path) = 0;
+
+    virtual void requestCheckpoint() = 0;
+};
+
+template <typename Metric = EuclideanMetric, typename T = double>
+class Hybrid : public HybridBase {
+public:
+    typedef std::pair<T,T> Point;
+
     Hybrid(const std::vector<std::pair<double,double>>& pts,
            int num_salesmen,
            int smo_iterations,
@@ -22,7 +52,23 @@ public:
            double aco_alpha,
            double aco_beta,
            double aco_rho,
-           double aco_Q);
+           double aco_Q,
+           int aco_islands = 1,
+           int aco_migration_interval = 25,
+           const std::string& checkpoint_path = "",
+           double checkpoint_interval = 0.0,
+           int smo_sample_size = 0,
+           bool smo_kmeans_pp = false,
+           int smo_lloyd_interval = 0,
+           int smo_lloyd_steps = 3,
+           const std::string& instance_cache = "",
+           bool cache_distances = true,
+           bool improve_routes = false,
+           int improve_neighbors = 10,
+           int improve_max_segment = 3,
+           int worker_processes = 0);
+
+    ~Hybrid();
 
     void run();
 
@@ -30,8 +76,45 @@ public:
 
     double getTotalLength() const;
 
+    // Restores SMO and per-cluster ACO state for the next run(); without it,
+    // run() always starts a fresh solve. Iteration counts may differ from the
+    // checkpointed run: solvers continue up to the new totals, and clusters
+    // whose membership changed are routed from scratch.
+    void loadCheckpoint(const std::string& path);
+
+    // Synchronously writes the current state (e.g. after run()) to `path`.
+    void saveCheckpoint(const std::string& path);
+
+    // Thread-safe: asks a running solve to checkpoint at its next iteration.
+    void requestCheckpoint();
+
 private:
-    Graph m_main_graph;
+    struct ClusterRecord {
+        std::vector<int> indices;
+        bool complete = false;
+        int aco_iterations = 0;
+        double length = 0.0;
+        std::vector<int> route;
+        CheckpointBlob aco_state;
+    };
+
+    static std::vector<Point> convertPoints(const std::vector<std::pair<double,double>>& pts);
+
+    template <typename Colony>
+    void routeCluster(Colony& aco, ClusterRecord& record);
+
+    void solveCluster(const Graph<Metric, T>& cluster_graph,
+                      const std::vector<int>& cluster_indices,
+                      ClusterRecord& record);
+    void routeClustersInWorkers();
+
+    static const int CACHE_NEIGHBORS = 10;
+
+    bool checkpointDue();
+    void writeCheckpoint(const std::string& path, bool async);
+    void serializeCheckpoint(CheckpointWriter& out) const;
+
+    Graph<Metric, T> m_main_graph;
     int m_num_salesmen;
     
     int m_smo_iterations;
@@ -39,6 +122,10 @@ private:
     int m_smo_local_limit;
     int m_smo_global_limit;
     double m_smo_pr;
+    int m_smo_sample_size;
+    bool m_smo_kmeans_pp;
+    int m_smo_lloyd_interval;
+    int m_smo_lloyd_steps;
 
     int m_aco_ants;
     int m_aco_iterations;
@@ -46,6 +133,26 @@ private:
     double m_aco_beta;
     double m_aco_rho;
     double m_aco_Q;
+    int m_aco_islands;
+    int m_aco_migration_interval;
+
+    // Inter-route post-optimization
+    bool m_improve_routes;
+    int m_improve_neighbors;
+    int m_improve_max_segment;
+
+    // Per-cluster routing in forked processes; 0 routes in this process
+    int m_worker_processes;
+
+    // Checkpointing
+    std::string m_checkpoint_path;
+    double m_checkpoint_interval; // seconds; 0 disables periodic checkpoints
+    std::atomic<bool> m_checkpoint_requested;
+    std::chrono::steady_clock::time_point m_last_checkpoint;
+    std::thread m_checkpoint_writer;
+    bool m_resume; // set by loadCheckpoint, consumed by the next run()
+    CheckpointBlob m_smo_state;
+    std::vector<ClusterRecord> m_records;
 
     // Results
     std::vector<std::vector<int>> m_clusters; 
@@ -0,0 +1,46 @@
+#pragma once
+#ifndef INTER_ROUTE_H
+#define INTER_ROUTE_H
+
+#include "graph.hpp"
+#include <vector>
+
+// Post-optimization across salesmen. Every route is a closed tour anchored at
+// its first city, which never moves. All moves exchange a segment of one route
+// with a (possibly empty) segment of another:
+//   relocate       - one city into an edge of another route
+//   swap           - one city for one city
+//   cross-exchange - segments of up to max_segment cities each
+//   2-opt*         - the tails after two cities (each route still returns home)
+// Candidates only pair a city with its k nearest neighbors in other routes and
+// are evaluated in O(1) from cached route/position indices.
+template <typename Metric = EuclideanMetric, typename T = double>
+class InterRoute {
+public:
+    InterRoute(const Graph<Metric, T>& g, int num_neighbors = 10, int max_segment = 3);
+
+    // Improves routes (first city repeated at the end, as Hybrid returns them)
+    // in place and returns the total length saved.
+    double improve(std::vector<std::vector<int>>& routes, int max_passes = 50);
+
+private:
+    struct Segment {
+        int route, begin, end; // positions [begin, end) in tours[route], begin >= 1
+    };
+
+    const Graph<Metric, T>& graph;
+    int num_neighbors;
+    int max_segment;
+
+    std::vector<std::vector<int>> tours; // cycles without the closing city
+    std::vector<int> route_of;
+    std::vector<int> pos_of;
+
+    double gapCost(const Segment& gap, const Segment& content) const;
+    double exchangeDelta(const Segment& a, const Segment& b) const;
+    void applyExchange(const Segment& a, const Segment& b);
+    void reindex(int r);
+    bool improveCity(int u);
+};
+
+#endif
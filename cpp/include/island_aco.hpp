@@ -0,0 +1,38 @@
+#pragma once
+#ifndef ISLAND_ACO_H
+#define ISLAND_ACO_H
+
+#include "aco.hpp"
+#include <memory>
+#include <vector>
+
+// Island-model ACO: several independent colonies (each with its own pheromone
+// matrix, tours and RNG) run concurrently on separate threads, all reading
+// the same graph, which must outlive the IslandACO. Every
+// `migration_interval` iterations the best tour across islands is broadcast
+// and reinforced in every colony.
+template <typename Metric = EuclideanMetric, typename T = double>
+class IslandACO {
+public:
+    IslandACO(const Graph<Metric, T>& g, int ants,
+              double alpha=1.0, double beta=5.0, double rho=0.5, double Q=100.0,
+              int num_islands=4, int migration_interval=25);
+    // `on_epoch` is invoked after every migration.
+    void run(int iterations, const std::function<void()>& on_epoch = std::function<void()>());
+    std::vector<int> final_route() const;
+    double best_distance() const;
+
+    // Saves every colony; on load, island i takes saved colony i % saved_count,
+    // so a checkpoint can be resumed with a different number of islands.
+    void save(CheckpointWriter& out) const;
+    void load(CheckpointReader& in);
+
+private:
+    std::vector<std::unique_ptr<ACO<Metric, T>>> islands;
+    int migration_interval;
+
+    int best_island() const;
+    void migrate();
+};
+
+#endif
@@ -0,0 +1,165 @@
+#pragma once
+#ifndef METRIC_H
+#define METRIC_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Compile-time distance policies. Graph, ACO, SMO and Hybrid are templated on
+// one of these plus a scalar type, so the distance kernel is inlined into the
+// inner loops instead of being dispatched at runtime.
+//
+// Every policy provides:
+//   distance(a, b)     - routing cost between two points (what tours are scored on)
+//   cluster_cost(a, b) - smooth cost used by SMO's SSE objective
+//   name()             - identifier used at the Python boundary
+
+// Plain Euclidean distance on planar coordinates.
+struct EuclideanMetric {
+    static const char* name() { return "euclidean"; }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        T dx = a.first - b.first;
+        T dy = a.second - b.second;
+        return std::sqrt(dx*dx + dy*dy);
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        T dx = a.first - b.first;
+        T dy = a.second - b.second;
+        return dx*dx + dy*dy;
+    }
+};
+
+// L1 (taxicab) distance on planar coordinates.
+struct ManhattanMetric {
+    static const char* name() { return "manhattan"; }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        return std::fabs(a.first - b.first) + std::fabs(a.second - b.second);
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        T d = distance(a, b);
+        return d * d;
+    }
+};
+
+// TSPLIB EUC_2D: Euclidean distance rounded to the nearest integer.
+struct Euc2DMetric {
+    static const char* name() { return "euc_2d"; }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        double dx = a.first - b.first;
+        double dy = a.second - b.second;
+        return static_cast<T>(static_cast<int>(std::sqrt(dx*dx + dy*dy) + 0.5));
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        return EuclideanMetric::cluster_cost(a, b);
+    }
+};
+
+// TSPLIB ATT: pseudo-Euclidean distance, rounded up.
+struct AttMetric {
+    static const char* name() { return "att"; }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        double dx = a.first - b.first;
+        double dy = a.second - b.second;
+        double r = std::sqrt((dx*dx + dy*dy) / 10.0);
+        int t = static_cast<int>(r + 0.5);
+        return static_cast<T>(t < r ? t + 1 : t);
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        return EuclideanMetric::cluster_cost(a, b) / T(10);
+    }
+};
+
+// TSPLIB GEO: points are (latitude, longitude) in DDD.MM format and the
+// distance is the truncated great-circle distance in km on the TSPLIB sphere.
+struct GeoMetric {
+    static const char* name() { return "geo"; }
+
+    static double to_radians(double x) {
+        const double PI = 3.141592;
+        int deg = static_cast<int>(x);
+        double min = x - deg;
+        return PI * (deg + 5.0 * min / 3.0) / 180.0;
+    }
+
+    static double arc(double lat_a, double lon_a, double lat_b, double lon_b) {
+        const double RRR = 6378.388;
+        double q1 = std::cos(to_radians(lon_a) - to_radians(lon_b));
+        double q2 = std::cos(to_radians(lat_a) - to_radians(lat_b));
+        double q3 = std::cos(to_radians(lat_a) + to_radians(lat_b));
+        return RRR * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3));
+    }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        return static_cast<T>(static_cast<int>(arc(a.first, a.second, b.first, b.second) + 1.0));
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        double d = arc(a.first, a.second, b.first, b.second);
+        return static_cast<T>(d * d);
+    }
+};
+
+// Great-circle distance in km; points are (latitude, longitude) in decimal degrees.
+struct HaversineMetric {
+    static const char* name() { return "haversine"; }
+
+    static double arc(double lat_a, double lon_a, double lat_b, double lon_b) {
+        const double R = 6371.0;
+        const double RAD = 3.14159265358979323846 / 180.0;
+        double dlat = (lat_b - lat_a) * RAD;
+        double dlon = (lon_b - lon_a) * RAD;
+        double s_lat = std::sin(dlat / 2.0);
+        double s_lon = std::sin(dlon / 2.0);
+        double h = s_lat * s_lat + std::cos(lat_a * RAD) * std::cos(lat_b * RAD) * s_lon * s_lon;
+        return 2.0 * R * std::asin(std::sqrt(std::min(1.0, h)));
+    }
+
+    template <typename T>
+    static T distance(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        return static_cast<T>(arc(a.first, a.second, b.first, b.second));
+    }
+
+    template <typename T>
+    static T cluster_cost(const std::pair<T,T>& a, const std::pair<T,T>& b) {
+        double d = arc(a.first, a.second, b.first, b.second);
+        return static_cast<T>(d * d);
+    }
+};
+
+// Every (metric, scalar) combination that is explicitly instantiated. The
+// source files expand this to instantiate their templates, and the Python
+// binding expands it to map a runtime (metric, precision) choice to a type.
+#define MTSP_FOR_EACH_POLICY(X) \
+    X(EuclideanMetric, double)  \
+    X(EuclideanMetric, float)   \
+    X(ManhattanMetric, double)  \
+    X(ManhattanMetric, float)   \
+    X(Euc2DMetric, double)      \
+    X(Euc2DMetric, float)       \
+    X(AttMetric, double)        \
+    X(AttMetric, float)         \
+    X(GeoMetric, double)        \
+    X(GeoMetric, float)         \
+    X(HaversineMetric, double)  \
+    X(HaversineMetric, float)
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Helpers for running solver work in forked worker processes on POSIX hosts.
+// Workers are isolated from the caller: a crash, abort or out-of-memory kill
+// in a worker is reported as a failed result instead of taking the host
+// (e.g. the Python interpreter) down with it.
+
+// Anonymous POSIX shared-memory segment (shm_open + mmap), mapped read/write
+// in the creating process and inherited by any worker forked afterwards. The
+// name is unlinked on destruction.
+class SharedSegment {
+public:
+    explicit SharedSegment(size_t size);
+    ~SharedSegment();
+
+    char* data() { return m_data; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    const std::string& name() const { return m_name; }
+
+private:
+    SharedSegment(const SharedSegment&);
+    SharedSegment& operator=(const SharedSegment&);
+
+    std::string m_name;
+    char* m_data;
+    size_t m_size;
+};
+
+struct WorkerResult {
+    bool ok = false;
+    std::vector<char> output;
+    std::string error; // why the worker failed, when !ok
+};
+
+// Forks `count` workers; worker w runs body(w) and sends the returned buffer
+// back over a pipe. Blocks until every worker has exited. A worker's output
+// is only kept if it exited cleanly and delivered the whole buffer.
+//
+// The body runs in a copy of the caller's address space with only the
+// forking thread alive, so it must not rely on other threads of the caller.
+std::vector<WorkerResult> runWorkers(int count, const std::function<std::vector<char>(int)>& body);
+
+#endif
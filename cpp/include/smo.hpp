@@ -3,51 +3,83 @@
 #define SMO_H
 
 #include "graph.hpp"
+#include "checkpoint.hpp"
+#include <functional>
 #include <vector>
 #include <utility>
 #include <random>
 
+template <typename Metric = EuclideanMetric, typename T = double>
 class SMO {
 public:
-    SMO(int num_clusters, int iterations, const Graph& g,
+    typedef std::pair<T, T> Point;
+
+    SMO(int num_clusters, int iterations, const Graph<Metric, T>& g,
         int population_size = 50, int local_leader_limit = 20,
-        int global_leader_limit = 20, double pr = 0.1);
+        int global_leader_limit = 20, double pr = 0.1,
+        int sample_size = 0, bool kmeans_pp = false,
+        int lloyd_interval = 0, int lloyd_steps = 3);
 
-    void run();
+    // `on_iteration` is invoked after every completed iteration (e.g. to checkpoint).
+    void run(const std::function<void()>& on_iteration = std::function<void()>());
 
     std::vector<std::vector<int>> getClusters() const;
 
+    // Population, leaders and counters. A loaded SMO skips initialize() and
+    // continues from the saved iteration up to its own iteration count.
+    void save(CheckpointWriter& out) const;
+    void load(CheckpointReader& in);
+
 private:
     int m_num_clusters;
     int m_iterations;
-    const Graph& m_graph;
+    const Graph<Metric, T>& m_graph;
     int m_population_size;
     int m_local_leader_limit;
     int m_global_leader_limit;
     double m_pr;
+    int m_sample_size; // 0 = always evaluate fitness on every point
+    bool m_kmeans_pp;     // seed monkeys with k-means++ instead of uniformly in the bounds
+    int m_lloyd_interval; // refine leaders every this many iterations; 0 = never
+    int m_lloyd_steps;    // Lloyd iterations per refinement
 
-    std::pair<double, double> m_x_bounds; 
-    std::pair<double, double> m_y_bounds; 
+    std::pair<T, T> m_x_bounds; 
+    std::pair<T, T> m_y_bounds; 
 
-    std::vector<std::vector<std::pair<double, double>>> m_population; // [pop_size][m_num_clusters]
-    std::vector<double> m_fitness;      // [pop_size]
+    std::vector<std::vector<Point>> m_population; // [pop_size][m_num_clusters]
+    std::vector<double> m_fitness;      // [pop_size], sampled estimate when a sample is used
 
-    std::vector<std::vector<std::pair<double, double>>> m_local_leaders;
-    std::vector<double> m_local_leader_fitness;
+    std::vector<std::vector<Point>> m_local_leaders;
+    std::vector<double> m_local_leader_fitness; // same scale as m_fitness
+    std::vector<double> m_local_leader_exact;   // exact SSE, recomputed only when the leader moves
     std::vector<int> m_local_leader_limit_count;
 
-    std::vector<std::pair<double, double>> m_global_leader;
-    double m_global_leader_fitness;
+    std::vector<Point> m_global_leader;
+    double m_global_leader_fitness; // always exact
     int m_global_leader_limit_count;
 
+    // Weighted stratified sample used to estimate SSE for candidate moves.
+    // Leaders and the final clustering are always evaluated exactly.
+    std::vector<Point> m_sample;
+    std::vector<double> m_sample_weight;
+
     std::vector<int> m_group_id; // Group ID for each monkey
     int m_num_groups;
 
+    int m_completed_iterations;
+    bool m_restored;
+
     std::mt19937 m_rng;
 
     void initialize();
-    double calculateFitness(const std::vector<std::pair<double, double>>& position);
-    double assignPointsToClusters(const std::vector<std::pair<double, double>>& position,
+    void buildSample();
+    int nearestCentroid(const Point& point, const std::vector<Point>& position, double& cost) const;
+    double exactFitness(const std::vector<Point>& position) const;
+    double calculateFitness(const std::vector<Point>& position);
+    void seedKMeansPP(std::vector<Point>& position);
+    double lloydRefine(std::vector<Point>& position);
+    void refineLeaders();
+    double assignPointsToClusters(const std::vector<Point>& position,
                                   std::vector<std::vector<int>>& clusters) const;
 
     // --- SMO Phases ---
@@ -57,7 +89,7 @@ private:
     void localLeaderLearningPhase();
     void localLeaderDecisionPhase();
 
-    void clampCentroid(std::pair<double, double>& centroid);
+    void clampCentroid(Point& centroid);
 };
 
 #endif 
\ No newline at end of file
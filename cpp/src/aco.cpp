@@ -2,32 +2,54 @@
 #include <iostream>
 #include <cmath>
 #include <limits>
+#include <stdexcept>
 #include <random>
+#include <algorithm>
 
-ACO::ACO(const std::vector<std::pair<double,double>>& pts, int ants,
+// Lower bound on an edge length when computing its heuristic 1/d
+static const double MIN_DISTANCE = 1e-6;
+
+template <typename Metric, typename T>
+ACO<Metric, T>::ACO(const std::vector<Point>& pts, int ants,
+        double alpha, double beta, double rho, double Q) :
+        owned_graph(new Graph<Metric, T>(pts)), graph(*owned_graph), num_ants(ants), alpha(alpha), beta(beta), rho(rho), Q(Q)       
+{
+    init();
+}
+
+template <typename Metric, typename T>
+ACO<Metric, T>::ACO(const Graph<Metric, T>& g, int ants,
         double alpha, double beta, double rho, double Q) :
-        graph(pts), num_ants(ants), alpha(alpha), beta(beta), rho(rho), Q(Q)       
+        graph(g), num_ants(ants), alpha(alpha), beta(beta), rho(rho), Q(Q)
 {
-    num_cities = pts.size();
+    init();
+}
+
+template <typename Metric, typename T>
+void ACO<Metric, T>::init(){
+    num_cities = graph.size();
     rng.seed(std::random_device{}());
     double L_nn = graph.nearest_neighbor_tour_length();
     double tau_0 = 1.0 / (num_cities * L_nn);
-    pher_mat.assign(num_cities, std::vector<double>(num_cities, tau_0));
+    pher_mat.assign(num_cities, std::vector<T>(num_cities, static_cast<T>(tau_0)));
     
     tours.assign(num_ants, std::vector<int>(num_cities, -1));
     tour_length.assign(num_ants, std::numeric_limits<double>::max());
     best_tour.assign(num_cities, -1);
     best_length = std::numeric_limits<double>::max();
+    iterations_done = 0;
 }
 
-int ACO::select_next_city(int ant_idx, int current_city, const std::vector<bool>& visited){
+template <typename Metric, typename T>
+int ACO<Metric, T>::select_next_city(int ant_idx, int current_city, const std::vector<bool>& visited){
     std::vector<double> prob(num_cities, 0.0);
     double sum = 0.0;
 
     for (int j = 0; j < num_cities; ++j) {
         if (!visited[j] && j != current_city) {
             double tau = pher_mat[current_city][j];
-            double eta = 1 / graph.getDistance(current_city, j);
+            // Rounded metrics (e.g. EUC_2D) give 0 for very close cities
+            double eta = 1 / std::max<double>(graph.getDistance(current_city, j), MIN_DISTANCE);
             double val = pow(tau, alpha) * pow(eta, beta);
             prob[j] = val;
             sum += val;
@@ -56,7 +78,8 @@ int ACO::select_next_city(int ant_idx, int current_city, const std::vector<bool>
     return 0;
 }
 
-void ACO::construct_tour(int ant_idx){
+template <typename Metric, typename T>
+void ACO<Metric, T>::construct_tour(int ant_idx){
     std::vector<bool> visited(num_cities, false);
     std::uniform_int_distribution<int> start_dist(0, num_cities - 1);
     int current = start_dist(rng);
@@ -84,7 +107,8 @@ void ACO::construct_tour(int ant_idx){
     }
 }
 
-void ACO::evaporate_pher(){
+template <typename Metric, typename T>
+void ACO<Metric, T>::evaporate_pher(){
     for(int i = 0; i < num_cities; i++){
         for(int j = 0; j < num_cities; j++){
             pher_mat[i][j] *= (1 - rho);
@@ -92,7 +116,8 @@ void ACO::evaporate_pher(){
     }
 }
 
-void ACO::deposit_pher(const std::vector<int>& path, double length){
+template <typename Metric, typename T>
+void ACO<Metric, T>::deposit_pher(const std::vector<int>& path, double length){
     int n = path.size();
     for(int i = 0; i < n-1; i++){
         pher_mat[path[i]][path[i + 1]] += Q / length;
@@ -102,21 +127,41 @@ void ACO::deposit_pher(const std::vector<int>& path, double length){
     pher_mat[path[0]][path[n - 1]] += Q / length;
 }
 
-void ACO::update_pher(){
+template <typename Metric, typename T>
+void ACO<Metric, T>::update_pher(){
     evaporate_pher();
     for(int i = 0; i < num_ants; i++){
         deposit_pher(tours[i], tour_length[i]);
     }
 }          
 
-void ACO::run(int iterations){
+// One colony iteration: every ant builds a tour, then pheromone is updated.
+template <typename Metric, typename T>
+void ACO<Metric, T>::step(){
+    for(int j = 0; j < num_ants; j++){
+        construct_tour(j);
+    }
+    update_pher();
+    iterations_done++;
+}
+
+// Reinforces a tour found by another colony and adopts it if it beats ours.
+template <typename Metric, typename T>
+void ACO<Metric, T>::accept_migrant(const std::vector<int>& tour, double length){
+    deposit_pher(tour, length);
+    if (length < best_length) {
+        best_length = length;
+        best_tour = tour;
+    }
+}
+
+template <typename Metric, typename T>
+void ACO<Metric, T>::run(int iterations, const std::function<void()>& on_iteration){
     double prev_best = std::numeric_limits<double>::max();
     double curr_best = std::numeric_limits<double>::max();
-    for(int i = 0; i < iterations; i++){
-        for(int j = 0; j < num_ants; j++){
-            construct_tour(j);
-        }
-        update_pher();
+    for(int i = iterations_done; i < iterations; i++){
+        step();
+        if (on_iteration) on_iteration();
         if (i % 100 == 0 || i == iterations - 1){
             prev_best = curr_best;
             curr_best = best_length;
@@ -126,7 +171,8 @@ void ACO::run(int iterations){
     }
 }
 
-std::vector<int> ACO::final_route() const{
+template <typename Metric, typename T>
+std::vector<int> ACO<Metric, T>::final_route() const{
     std::vector<int> route;
     route.reserve(num_cities + 1);
 
@@ -141,6 +187,42 @@ std::vector<int> ACO::final_route() const{
     return route;
 }
 
-double ACO::best_distance() const{
+template <typename Metric, typename T>
+double ACO<Metric, T>::best_distance() const{
     return best_length;
-}
\ No newline at end of file
+}
+
+template <typename Metric, typename T>
+int ACO<Metric, T>::iterations() const{
+    return iterations_done;
+}
+
+template <typename Metric, typename T>
+void ACO<Metric, T>::save(CheckpointWriter& out) const{
+    out.put<int32_t>(num_cities);
+    out.put<int32_t>(iterations_done);
+    out.put(best_length);
+    out.putVector(best_tour);
+    for (const auto& row : pher_mat) out.putVector(row);
+}
+
+template <typename Metric, typename T>
+void ACO<Metric, T>::load(CheckpointReader& in){
+    if (in.get<int32_t>() != num_cities)
+        throw std::runtime_error("ACO checkpoint does not match the cluster size");
+    iterations_done = in.get<int32_t>();
+    best_length = in.get<double>();
+    in.getVector(best_tour);
+    for (auto& row : pher_mat) in.getVector(row);
+
+    if ((int)best_tour.size() != num_cities)
+        throw std::runtime_error("ACO checkpoint is inconsistent");
+    for (const auto& row : pher_mat) {
+        if ((int)row.size() != num_cities)
+            throw std::runtime_error("ACO checkpoint is inconsistent");
+    }
+}
+
+#define INSTANTIATE_ACO(M, T) template class ACO<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_ACO)
+#undef INSTANTIATE_ACO
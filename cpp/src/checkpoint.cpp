@@ -0,0 +1,123 @@
+#include "checkpoint.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void CheckpointWriter::align(size_t alignment) {
+    while (m_buf.size() % alignment != 0)
+        m_buf.push_back(0);
+}
+
+void CheckpointWriter::putString(const std::string& s) {
+    put<uint64_t>(s.size());
+    m_buf.insert(m_buf.end(), s.begin(), s.end());
+}
+
+void CheckpointWriter::putBlob(const std::vector<char>& blob) {
+    putVector(blob);
+}
+
+void CheckpointWriter::putBlob(const CheckpointBlob& blob) {
+    put<uint64_t>(blob.size());
+    m_buf.insert(m_buf.end(), blob.data(), blob.data() + blob.size());
+}
+
+void CheckpointWriter::writeFile(const std::string& path) const {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Cannot open file for writing: " + tmp);
+        out.write(m_buf.data(), m_buf.size());
+        if (!out)
+            throw std::runtime_error("Failed writing checkpoint file: " + tmp);
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot move file into place: " + path);
+}
+
+CheckpointReader::CheckpointReader(const char* data, size_t size)
+    : m_data(data), m_size(size), m_pos(0), m_mapping(nullptr)
+{
+}
+
+CheckpointReader::CheckpointReader(const std::string& path)
+    : m_data(nullptr), m_size(0), m_pos(0), m_mapping(nullptr)
+{
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file: " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+    m_size = st.st_size;
+    if (m_size > 0) {
+        void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        m_mapping = p;
+        m_data = static_cast<const char*>(p);
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open file: " + path);
+    m_owned.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    m_data = m_owned.data();
+    m_size = m_owned.size();
+#endif
+}
+
+CheckpointReader::~CheckpointReader() {
+#ifndef _WIN32
+    if (m_mapping)
+        ::munmap(m_mapping, m_size);
+#endif
+}
+
+const char* CheckpointReader::take(size_t n) {
+    if (n > m_size - m_pos)
+        throw std::runtime_error("Checkpoint is truncated or corrupt");
+    const char* p = m_data + m_pos;
+    m_pos += n;
+    return p;
+}
+
+void CheckpointReader::align(size_t alignment) {
+    size_t pad = (alignment - m_pos % alignment) % alignment;
+    take(pad);
+}
+
+std::string CheckpointReader::getString() {
+    uint64_t n = get<uint64_t>();
+    const char* p = take(n);
+    return std::string(p, p + n);
+}
+
+std::vector<char> CheckpointReader::getBlob() {
+    std::vector<char> blob;
+    getVector(blob);
+    return blob;
+}
+
+const char* CheckpointReader::viewBlob(size_t& size) {
+    uint64_t n = get<uint64_t>();
+    size = n;
+    return take(n);
+}
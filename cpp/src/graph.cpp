@@ -1,40 +1,156 @@
 #include "graph.hpp"
+#include <algorithm>
 #include <cmath>
+#include <iostream>
+#include <limits>
 
-Graph::Graph(const std::vector<std::pair<double,double>>& pts) : Points(pts){
-    computeDistanceMatrix();
+const char INSTANCE_CACHE_MAGIC[8] = {'M', 'T', 'S', 'P', 'I', 'N', 'S', 'T'};
+const uint32_t INSTANCE_CACHE_VERSION = 1;
+
+template <typename Metric, typename T>
+Graph<Metric, T>::Graph(const std::vector<Point>& pts, bool compute_dist) :
+    Points(pts), n(pts.size()), dist(nullptr), neighbors(nullptr), num_neighbors(0), nn_length(-1.0)
+{
+    computeBounds();
+    if (compute_dist)
+        computeDistanceMatrix();
+}
+
+template <typename Metric, typename T>
+Graph<Metric, T>::Graph(const Graph& parent, const std::vector<int>& subset) :
+    n(subset.size()), dist(nullptr), neighbors(nullptr), num_neighbors(0), nn_length(-1.0)
+{
+    Points.reserve(n);
+    for (int idx : subset)
+        Points.push_back(parent.Points[idx]);
+    computeBounds();
+
+    if (!parent.dist) {
+        computeDistanceMatrix();
+        return;
+    }
+    dist_storage.resize((size_t)n * n);
+    for (int i = 0; i < n; i++){
+        const T* row = parent.dist + (size_t)subset[i] * parent.n;
+        for (int j = 0; j < n; j++){
+            dist_storage[(size_t)i * n + j] = row[subset[j]];
+        }
+    }
+    dist = dist_storage.data();
+
+    bool identity = n == parent.n;
+    for (int i = 0; identity && i < n; i++)
+        identity = subset[i] == i;
+    if (identity)
+        nn_length = parent.nn_length;
+}
+
+template <typename Metric, typename T>
+Graph<Metric, T>::Graph(const Graph& other) :
+    Points(other.Points), n(other.n),
+    dist_storage(other.dist_storage), neighbor_storage(other.neighbor_storage),
+    num_neighbors(other.num_neighbors),
+    x_bounds(other.x_bounds), y_bounds(other.y_bounds),
+    nn_length(other.nn_length), mapping(other.mapping)
+{
+    rebind(other);
+}
+
+template <typename Metric, typename T>
+Graph<Metric, T>& Graph<Metric, T>::operator=(const Graph& other) {
+    if (this != &other) {
+        Points = other.Points;
+        n = other.n;
+        dist_storage = other.dist_storage;
+        neighbor_storage = other.neighbor_storage;
+        num_neighbors = other.num_neighbors;
+        x_bounds = other.x_bounds;
+        y_bounds = other.y_bounds;
+        nn_length = other.nn_length;
+        mapping = other.mapping;
+        rebind(other);
+    }
+    return *this;
+}
+
+// Point dist/neighbors at our own copies, or keep sharing other's mapping.
+template <typename Metric, typename T>
+void Graph<Metric, T>::rebind(const Graph& other) {
+    dist = other.dist && !other.dist_storage.empty() ? dist_storage.data() : other.dist;
+    neighbors = other.neighbors && !other.neighbor_storage.empty() ? neighbor_storage.data() : other.neighbors;
+}
+
+template <typename Metric, typename T>
+void Graph<Metric, T>::computeBounds(){
+    x_bounds = {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    y_bounds = {std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest()};
+    for (const auto& pt : Points) {
+        if (pt.first < x_bounds.first) x_bounds.first = pt.first;
+        if (pt.first > x_bounds.second) x_bounds.second = pt.first;
+        if (pt.second < y_bounds.first) y_bounds.first = pt.second;
+        if (pt.second > y_bounds.second) y_bounds.second = pt.second;
+    }
 }
 
-void Graph::computeDistanceMatrix(){
-    int n = Points.size();
-    dist.assign(n, std::vector<double>(n));
+template <typename Metric, typename T>
+void Graph<Metric, T>::computeDistanceMatrix(){
+    dist_storage.assign((size_t)n * n, T());
     for(int i = 0; i < n; i++){
         for(int j = 0; j < n; j++){
-            int dx = Points[i].first - Points[j].first;
-            int dy = Points[i].second - Points[j].second;
-            dist[i][j] = std::sqrt(dx*dx + dy*dy);  
+            dist_storage[(size_t)i * n + j] = Metric::distance(Points[i], Points[j]);
         }
     }
+    dist = dist_storage.data();
 }
 
-double Graph::getDistance(int i, int j) const {
-    return dist[i][j];
+template <typename Metric, typename T>
+T Graph<Metric, T>::distanceOf(int i, int j) const {
+    return dist ? getDistance(i, j) : Metric::distance(Points[i], Points[j]);
 }
 
-int Graph::size() const {
-    return Points.size();
+template <typename Metric, typename T>
+void Graph<Metric, T>::computeNeighbors(int k){
+    num_neighbors = std::max(0, std::min(k, n - 1));
+    neighbor_storage.assign((size_t)n * num_neighbors, 0);
+    std::vector<int> order(n);
+    for(int i = 0; i < n; i++){
+        int m = 0;
+        for(int j = 0; j < n; j++){
+            if (j != i) order[m++] = j;
+        }
+        std::partial_sort(order.begin(), order.begin() + num_neighbors, order.begin() + m,
+                          [this, i](int a, int b) { return distanceOf(i, a) < distanceOf(i, b); });
+        std::copy(order.begin(), order.begin() + num_neighbors,
+                  neighbor_storage.begin() + (size_t)i * num_neighbors);
+    }
+    neighbors = neighbor_storage.data();
 }
 
-const std::vector<std::pair<double,double>>& Graph::getPoints() const {
+template <typename Metric, typename T>
+const std::vector<typename Graph<Metric, T>::Point>& Graph<Metric, T>::getPoints() const {
     return Points;
 }
 
-const std::vector<std::vector<double>>& Graph::getDist() const {
+template <typename Metric, typename T>
+const T* Graph<Metric, T>::getDist() const {
     return dist;
 }
 
-const double Graph::nearest_neighbor_tour_length() const {
-    int n = Points.size();
+template <typename Metric, typename T>
+const std::pair<T,T>& Graph<Metric, T>::getXBounds() const {
+    return x_bounds;
+}
+
+template <typename Metric, typename T>
+const std::pair<T,T>& Graph<Metric, T>::getYBounds() const {
+    return y_bounds;
+}
+
+template <typename Metric, typename T>
+const double Graph<Metric, T>::nearest_neighbor_tour_length() const {
+    if (nn_length >= 0.0)
+        return nn_length;
+
     std::vector<bool> visited(n, false);
     double best_length = 0.0;
     int current = 0;
@@ -45,7 +161,7 @@ const double Graph::nearest_neighbor_tour_length() const {
         int next = -1;
         for (int j = 0; j < n; ++j) {
             if (!visited[j] && j != current) {
-                double d = getDistance(current, j);
+                double d = distanceOf(current, j);
                 if (d < best) {
                     best = d;
                     next = j;
@@ -56,6 +172,106 @@ const double Graph::nearest_neighbor_tour_length() const {
         visited[next] = true;
         current = next;
     }
-    best_length += getDistance(current, 0);  
+    best_length += distanceOf(current, 0);  
+    nn_length = best_length;
     return best_length;
 }
+
+template <typename Metric, typename T>
+uint64_t Graph<Metric, T>::contentHash() const {
+    std::string metric = Metric::name();
+    uint32_t scalar = sizeof(T);
+    uint64_t h = fnv1a(metric.data(), metric.size());
+    h = fnv1a(&scalar, sizeof(scalar), h);
+    for (const auto& p : Points) {
+        h = fnv1a(&p.first, sizeof(T), h);
+        h = fnv1a(&p.second, sizeof(T), h);
+    }
+    return h;
+}
+
+// Layout (version 1): magic, version, metric, sizeof(T), n, content hash,
+// bounds, nearest-neighbor tour length, coordinates, k + neighbor lists,
+// has_dist + distance matrix. Arrays are aligned so they can be viewed in place.
+template <typename Metric, typename T>
+void Graph<Metric, T>::saveCache(const std::string& path, bool with_dist) const {
+    CheckpointWriter out;
+    for (char c : INSTANCE_CACHE_MAGIC) out.put(c);
+    out.put<uint32_t>(INSTANCE_CACHE_VERSION);
+    out.putString(Metric::name());
+    out.put<uint32_t>(sizeof(T));
+    out.put<uint64_t>(n);
+    out.put<uint64_t>(contentHash());
+
+    out.put(x_bounds.first);
+    out.put(x_bounds.second);
+    out.put(y_bounds.first);
+    out.put(y_bounds.second);
+    out.put<double>(n > 0 ? nearest_neighbor_tour_length() : 0.0);
+
+    std::vector<T> coords;
+    coords.reserve((size_t)2 * n);
+    for (const auto& p : Points) {
+        coords.push_back(p.first);
+        coords.push_back(p.second);
+    }
+    out.putArray(coords.data(), coords.size());
+
+    out.put<int32_t>(num_neighbors);
+    out.putArray(neighbors, (size_t)n * num_neighbors);
+
+    bool has_dist = with_dist && dist;
+    out.put<uint8_t>(has_dist ? 1 : 0);
+    if (has_dist)
+        out.putArray(dist, (size_t)n * n);
+
+    out.writeFile(path);
+}
+
+template <typename Metric, typename T>
+bool Graph<Metric, T>::loadCache(const std::string& path) {
+    try {
+        std::shared_ptr<CheckpointReader> in = std::make_shared<CheckpointReader>(path);
+        for (char c : INSTANCE_CACHE_MAGIC) {
+            if (in->get<char>() != c)
+                throw std::runtime_error("not an instance cache");
+        }
+        if (in->get<uint32_t>() != INSTANCE_CACHE_VERSION)
+            throw std::runtime_error("unsupported cache version");
+        if (in->getString() != Metric::name() || in->get<uint32_t>() != sizeof(T) ||
+            in->get<uint64_t>() != (uint64_t)n || in->get<uint64_t>() != contentHash())
+            throw std::runtime_error("stale cache (points, metric or precision changed)");
+
+        x_bounds.first = in->get<T>();
+        x_bounds.second = in->get<T>();
+        y_bounds.first = in->get<T>();
+        y_bounds.second = in->get<T>();
+        double cached_nn_length = in->get<double>();
+        in->viewArray<T>((size_t)2 * n); // coordinates: already verified by the hash
+
+        int k = in->get<int32_t>();
+        const int* cached_neighbors = in->viewArray<int>((size_t)n * k);
+        const T* cached_dist = nullptr;
+        if (in->get<uint8_t>() != 0)
+            cached_dist = in->viewArray<T>((size_t)n * n);
+
+        nn_length = cached_nn_length;
+        num_neighbors = k;
+        neighbor_storage.clear();
+        neighbors = cached_neighbors;
+        if (cached_dist) {
+            dist_storage.clear();
+            dist = cached_dist;
+        }
+        mapping = in;
+        std::cout << "Loaded instance cache " << path << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "Instance cache " << path << " not used: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+#define INSTANTIATE_GRAPH(M, T) template class Graph<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_GRAPH)
+#undef INSTANTIATE_GRAPH
@@ -1,7 +1,12 @@
 #include "hybrid.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 
-Hybrid::Hybrid(const std::vector<std::pair<double,double>>& pts,
+template <typename Metric, typename T>
+Hybrid<Metric, T>::Hybrid(const std::vector<std::pair<double,double>>& pts,
                int num_salesmen,
                int smo_iterations,
                int smo_population_size,
@@ -13,40 +18,343 @@ Hybrid::Hybrid(const std::vector<std::pair<double,double>>& pts,
                double aco_alpha,
                double aco_beta,
                double aco_rho,
-               double aco_Q)
-    : m_main_graph(pts),
+               double aco_Q,
+               int aco_islands,
+               int aco_migration_interval,
+               const std::string& checkpoint_path,
+               double checkpoint_interval,
+               int smo_sample_size,
+               bool smo_kmeans_pp,
+               int smo_lloyd_interval,
+               int smo_lloyd_steps,
+               const std::string& instance_cache,
+               bool cache_distances,
+               bool improve_routes,
+               int improve_neighbors,
+               int improve_max_segment,
+               int worker_processes)
+    : m_main_graph(convertPoints(pts), instance_cache.empty()),
       m_num_salesmen(num_salesmen),
       m_smo_iterations(smo_iterations),
       m_smo_population_size(smo_population_size),
       m_smo_local_limit(smo_local_limit),
       m_smo_global_limit(smo_global_limit),
       m_smo_pr(smo_pr),
+      m_smo_sample_size(smo_sample_size),
+      m_smo_kmeans_pp(smo_kmeans_pp),
+      m_smo_lloyd_interval(smo_lloyd_interval),
+      m_smo_lloyd_steps(smo_lloyd_steps),
       m_aco_ants(aco_ants),
       m_aco_iterations(aco_iterations),
       m_aco_alpha(aco_alpha),
       m_aco_beta(aco_beta),
       m_aco_rho(aco_rho),
       m_aco_Q(aco_Q),
+      m_aco_islands(aco_islands),
+      m_aco_migration_interval(aco_migration_interval),
+      m_improve_routes(improve_routes),
+      m_improve_neighbors(improve_neighbors),
+      m_improve_max_segment(improve_max_segment),
+      m_worker_processes(worker_processes),
+      m_checkpoint_path(checkpoint_path),
+      m_checkpoint_interval(checkpoint_interval),
+      m_checkpoint_requested(false),
+      m_resume(false),
       m_total_length(0.0)
 {
+    // Reuse derived instance data from disk when it matches these points
+    if (!instance_cache.empty() && !m_main_graph.loadCache(instance_cache)) {
+        m_main_graph.computeDistanceMatrix();
+        m_main_graph.computeNeighbors(CACHE_NEIGHBORS);
+        try {
+            m_main_graph.saveCache(instance_cache, cache_distances);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: could not write instance cache: " << e.what() << std::endl;
+        }
+    }
+    if (!m_main_graph.getDist())
+        m_main_graph.computeDistanceMatrix();
+}
+
+template <typename Metric, typename T>
+Hybrid<Metric, T>::~Hybrid() {
+    if (m_checkpoint_writer.joinable())
+        m_checkpoint_writer.join();
+}
+
+template <typename Metric, typename T>
+std::vector<typename Hybrid<Metric, T>::Point>
+Hybrid<Metric, T>::convertPoints(const std::vector<std::pair<double,double>>& pts) {
+    std::vector<Point> out;
+    out.reserve(pts.size());
+    for (const auto& p : pts) {
+        out.push_back(Point(static_cast<T>(p.first), static_cast<T>(p.second)));
+    }
+    return out;
+}
+
+// Colony state is always stored as a count followed by one blob per colony,
+// so plain and island ACO checkpoints are interchangeable.
+template <typename Metric, typename T>
+static CheckpointBlob saveColonies(const ACO<Metric, T>& aco) {
+    CheckpointWriter colony;
+    aco.save(colony);
+    CheckpointWriter out;
+    out.put<uint32_t>(1);
+    out.putBlob(colony.buffer());
+    return CheckpointBlob(out.buffer());
+}
+
+template <typename Metric, typename T>
+static CheckpointBlob saveColonies(const IslandACO<Metric, T>& aco) {
+    CheckpointWriter out;
+    aco.save(out);
+    return CheckpointBlob(out.buffer());
+}
+
+template <typename Metric, typename T>
+static void loadColonies(ACO<Metric, T>& aco, const CheckpointBlob& state) {
+    CheckpointReader in(state.data(), state.size());
+    if (in.get<uint32_t>() == 0)
+        throw std::runtime_error("ACO checkpoint has no colonies");
+    size_t size;
+    const char* colony = in.viewBlob(size);
+    CheckpointReader reader(colony, size);
+    aco.load(reader);
+}
+
+template <typename Metric, typename T>
+static void loadColonies(IslandACO<Metric, T>& aco, const CheckpointBlob& state) {
+    CheckpointReader in(state.data(), state.size());
+    aco.load(in);
+}
+
+template <typename Metric, typename T>
+template <typename Colony>
+void Hybrid<Metric, T>::routeCluster(Colony& aco, ClusterRecord& record) {
+    if (!record.aco_state.empty())
+        loadColonies(aco, record.aco_state);
+
+    aco.run(m_aco_iterations, [this, &aco, &record]() {
+        if (checkpointDue()) {
+            record.aco_state = saveColonies(aco);
+            writeCheckpoint(m_checkpoint_path, true);
+        }
+    });
+    record.aco_state = saveColonies(aco);
+}
+
+// Runs ACO (or island ACO) on one cluster and stores the route, translated
+// back to original indices, in `record`.
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::solveCluster(const Graph<Metric, T>& cluster_graph,
+                                     const std::vector<int>& cluster_indices,
+                                     ClusterRecord& record) {
+    std::vector<int> local_route;
+    double best_distance;
+    if (m_aco_islands > 1) {
+        IslandACO<Metric, T> aco(cluster_graph,
+                m_aco_ants,
+                m_aco_alpha,
+                m_aco_beta,
+                m_aco_rho,
+                m_aco_Q,
+                m_aco_islands,
+                m_aco_migration_interval);
+
+        routeCluster(aco, record);
+        local_route = aco.final_route();
+        best_distance = aco.best_distance();
+    } else {
+        ACO<Metric, T> aco(cluster_graph,
+                m_aco_ants,
+                m_aco_alpha,
+                m_aco_beta,
+                m_aco_rho,
+                m_aco_Q);
+
+        routeCluster(aco, record);
+        local_route = aco.final_route();
+        best_distance = aco.best_distance();
+    }
+
+    std::vector<int> global_route;
+    global_route.reserve(local_route.size());
+    for (int local_index : local_route) {
+        global_route.push_back(cluster_indices[local_index]);
+    }
+
+    record.complete = true;
+    record.aco_iterations = m_aco_iterations;
+    record.length = best_distance;
+    record.route = global_route;
+}
+
+// Shards the unfinished clusters round-robin over forked workers. The points
+// and cluster membership are published in a shared-memory segment and each
+// worker builds its own cluster graphs from it, so the workers never touch
+// the main distance matrix. Results (route, length, colony state) come back
+// over pipes. Clusters of a worker that crashed are retried once in a fresh
+// worker; if that fails too, run() throws instead of routing them here.
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::routeClustersInWorkers() {
+    std::vector<int> pending;
+    size_t num_members = 0;
+    for (int i = 0; i < (int)m_clusters.size(); ++i) {
+        const ClusterRecord& record = m_records[i];
+        if (!m_clusters[i].empty() && !(record.complete && record.aco_iterations >= m_aco_iterations))
+            pending.push_back(i);
+        num_members += m_clusters[i].size();
+    }
+    if (pending.empty())
+        return;
+
+    // Layout: x/y of every point, then per-cluster offsets into the member
+    // list (num_clusters + 1 entries), then the members themselves.
+    const std::vector<Point>& pts = m_main_graph.getPoints();
+    size_t offsets_at = (2 * pts.size() * sizeof(T) + 7) / 8 * 8;
+    size_t members_at = offsets_at + (m_clusters.size() + 1) * sizeof(uint64_t);
+    SharedSegment shm(members_at + num_members * sizeof(int32_t));
+
+    T* shared_points = reinterpret_cast<T*>(shm.data());
+    uint64_t* shared_offsets = reinterpret_cast<uint64_t*>(shm.data() + offsets_at);
+    int32_t* shared_members = reinterpret_cast<int32_t*>(shm.data() + members_at);
+    for (size_t i = 0; i < pts.size(); ++i) {
+        shared_points[2 * i] = pts[i].first;
+        shared_points[2 * i + 1] = pts[i].second;
+    }
+    shared_offsets[0] = 0;
+    for (size_t c = 0; c < m_clusters.size(); ++c) {
+        std::copy(m_clusters[c].begin(), m_clusters[c].end(), shared_members + shared_offsets[c]);
+        shared_offsets[c + 1] = shared_offsets[c] + m_clusters[c].size();
+    }
+
+    // Don't fork while the checkpoint thread may hold locks
+    if (m_checkpoint_writer.joinable())
+        m_checkpoint_writer.join();
+
+    for (int attempt = 0; attempt < 2 && !pending.empty(); ++attempt) {
+        int workers = std::min<int>(m_worker_processes, pending.size());
+        std::cout << "Routing " << pending.size() << " clusters in " << workers << " worker processes..." << std::endl;
+
+        std::vector<WorkerResult> results = runWorkers(workers, [&](int w) {
+            // This is the worker's private copy of the solver: only the
+            // parent writes checkpoints.
+            m_checkpoint_path.clear();
+
+            CheckpointWriter out;
+            for (size_t s = w; s < pending.size(); s += workers) {
+                int c = pending[s];
+                std::vector<int> cluster_indices(shared_members + shared_offsets[c],
+                                                 shared_members + shared_offsets[c + 1]);
+                std::vector<Point> cluster_points;
+                cluster_points.reserve(cluster_indices.size());
+                for (int idx : cluster_indices)
+                    cluster_points.push_back(Point(shared_points[2 * idx], shared_points[2 * idx + 1]));
+
+                std::cout << "--- Worker " << w << " solving cluster " << c << " (size " << cluster_indices.size() << ") ---" << std::endl;
+                Graph<Metric, T> cluster_graph(cluster_points);
+                ClusterRecord& record = m_records[c];
+                solveCluster(cluster_graph, cluster_indices, record);
+
+                out.put<int32_t>(c);
+                out.put(record.length);
+                out.putVector(record.route);
+                out.putBlob(record.aco_state);
+            }
+            return out.buffer();
+        });
+
+        std::vector<int> failed;
+        for (int w = 0; w < workers; ++w) {
+            if (!results[w].ok) {
+                std::cerr << "Warning: routing worker " << w << " " << results[w].error << std::endl;
+                for (size_t s = w; s < pending.size(); s += workers)
+                    failed.push_back(pending[s]);
+                continue;
+            }
+            CheckpointReader in(results[w].output.data(), results[w].output.size());
+            for (size_t s = w; s < pending.size(); s += workers) {
+                int c = in.get<int32_t>();
+                if (c != pending[s])
+                    throw std::runtime_error("Routing worker returned clusters out of order");
+                ClusterRecord& record = m_records[c];
+                record.length = in.get<double>();
+                in.getVector(record.route);
+                record.aco_state = CheckpointBlob(in.getBlob());
+                record.complete = true;
+                record.aco_iterations = m_aco_iterations;
+            }
+        }
+        pending.swap(failed);
+
+        if (checkpointDue())
+            writeCheckpoint(m_checkpoint_path, false);
+    }
+
+    if (!pending.empty())
+        throw std::runtime_error("Routing workers failed for " + std::to_string(pending.size()) + " clusters");
 }
 
-void Hybrid::run() {
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::run() {
+    m_last_checkpoint = std::chrono::steady_clock::now();
+
+    // Every run is a fresh solve unless a checkpoint was loaded just before it
+    if (!m_resume) {
+        m_smo_state = CheckpointBlob();
+        m_records.clear();
+    }
+    m_resume = false;
+
     // 1. Create SMO and get clusters
     std::cout << "Starting SMO clustering..." << std::endl;
-    SMO smo(m_num_salesmen, m_smo_iterations, m_main_graph,
+    SMO<Metric, T> smo(m_num_salesmen, m_smo_iterations, m_main_graph,
             m_smo_population_size, m_smo_local_limit, 
-            m_smo_global_limit, m_smo_pr);
+            m_smo_global_limit, m_smo_pr, m_smo_sample_size,
+            m_smo_kmeans_pp, m_smo_lloyd_interval, m_smo_lloyd_steps);
+
+    if (!m_smo_state.empty()) {
+        CheckpointReader in(m_smo_state.data(), m_smo_state.size());
+        smo.load(in);
+    }
             
-    smo.run();
+    smo.run([this, &smo]() {
+        if (checkpointDue()) {
+            CheckpointWriter out;
+            smo.save(out);
+            m_smo_state = CheckpointBlob(out.buffer());
+            writeCheckpoint(m_checkpoint_path, true);
+        }
+    });
+    {
+        CheckpointWriter out;
+        smo.save(out);
+        m_smo_state = CheckpointBlob(out.buffer());
+    }
     m_clusters = smo.getClusters();
     std::cout << "Clustering complete." << std::endl;
 
+    // Keep routing state from a checkpoint only for clusters that came out identical
+    std::vector<ClusterRecord> records(m_clusters.size());
+    for (size_t i = 0; i < m_clusters.size(); ++i) {
+        records[i].indices = m_clusters[i];
+        for (const auto& old : m_records) {
+            if (old.indices == m_clusters[i]) {
+                records[i] = old;
+                break;
+            }
+        }
+    }
+    m_records.swap(records);
+
+    // 2. Optionally route the clusters in worker processes first
+    if (m_worker_processes > 0)
+        routeClustersInWorkers();
+
     m_final_routes.clear();
     m_total_length = 0.0;
-    const auto& all_points = m_main_graph.getPoints();
-
-    // 2. Loop through each cluster and run ACO
+    // 3. Loop through each cluster and run ACO on whatever is left
     for (int i = 0; i < m_clusters.size(); ++i) {
         const auto& cluster_indices = m_clusters[i];
         
@@ -55,48 +363,163 @@ void Hybrid::run() {
             m_final_routes.push_back({}); 
             continue;
         }
+
+        ClusterRecord& record = m_records[i];
+        if (record.complete && record.aco_iterations >= m_aco_iterations) {
+            m_final_routes.push_back(record.route);
+            m_total_length += record.length;
+            std::cout << "--- Cluster " << i << " already routed. Best distance: " << record.length << " ---" << std::endl;
+            continue;
+        }
         
         std::cout << "--- Solving route for cluster " << i << " (size " << cluster_indices.size() << ") ---" << std::endl;
 
-        // 3. Create a new set of points for this cluster
-        std::vector<std::pair<double, double>> cluster_points;
-        cluster_points.reserve(cluster_indices.size());
-        for (int original_index : cluster_indices) {
-            cluster_points.push_back(all_points[original_index]);
-        }
+        // 4. Create the cluster's graph, reusing the main distance matrix
+        Graph<Metric, T> cluster_graph(m_main_graph, cluster_indices);
 
-        // 4. Create and run ACO on the cluster-specific points
-        ACO aco(cluster_points,
-                m_aco_ants,
-                m_aco_alpha,
-                m_aco_beta,
-                m_aco_rho,
-                m_aco_Q);
-                
-        aco.run(m_aco_iterations);
+        // 5. Run ACO on it
+        solveCluster(cluster_graph, cluster_indices, record);
 
-        // 5. Get the local route and translate it back to original indices
-        std::vector<int> local_route = aco.final_route();
-        std::vector<int> global_route;
-        global_route.reserve(local_route.size());
-
-        for (int local_index : local_route) {
-            global_route.push_back(cluster_indices[local_index]);
-        }
+        m_final_routes.push_back(record.route);
+        m_total_length += record.length;
+        std::cout << "--- Cluster " << i << " complete. Best distance: " << record.length << " ---" << std::endl;
+    }
 
-        m_final_routes.push_back(global_route);
-        m_total_length += aco.best_distance();
-        std::cout << "--- Cluster " << i << " complete. Best distance: " << aco.best_distance() << " ---" << std::endl;
+    // 6. Move cities across route borders
+    if (m_improve_routes) {
+        if (m_main_graph.getNumNeighbors() < m_improve_neighbors)
+            m_main_graph.computeNeighbors(m_improve_neighbors);
+        InterRoute<Metric, T> improver(m_main_graph, m_improve_neighbors, m_improve_max_segment);
+        double saved = improver.improve(m_final_routes);
+        m_total_length -= saved;
+        std::cout << "Inter-route improvement saved " << saved << std::endl;
     }
     std::cout << "=============================================" << std::endl;
     std::cout << "All routes solved. Total combined length: " << m_total_length << std::endl;
     std::cout << "=============================================" << std::endl;
+
+    if (!m_checkpoint_path.empty())
+        writeCheckpoint(m_checkpoint_path, false);
+}
+
+template <typename Metric, typename T>
+bool Hybrid<Metric, T>::checkpointDue() {
+    if (m_checkpoint_path.empty())
+        return false;
+    if (m_checkpoint_requested.exchange(false))
+        return true;
+    if (m_checkpoint_interval <= 0.0)
+        return false;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_last_checkpoint;
+    return elapsed.count() >= m_checkpoint_interval;
+}
+
+// Serializing is done on the solver thread (it only copies the state into a
+// buffer); the file itself is written on a background thread when `async`.
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::writeCheckpoint(const std::string& path, bool async) {
+    std::shared_ptr<CheckpointWriter> out = std::make_shared<CheckpointWriter>();
+    serializeCheckpoint(*out);
+
+    if (m_checkpoint_writer.joinable())
+        m_checkpoint_writer.join();
+    m_last_checkpoint = std::chrono::steady_clock::now();
+
+    if (!async) {
+        out->writeFile(path);
+        return;
+    }
+    m_checkpoint_writer = std::thread([out, path]() {
+        try {
+            out->writeFile(path);
+        } catch (const std::exception& e) {
+            std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+        }
+    });
+}
+
+// Layout (version 2): header, SMO state blob (empty before clustering), then
+// one record per cluster with its route and colony state blob.
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::serializeCheckpoint(CheckpointWriter& out) const {
+    for (char c : CHECKPOINT_MAGIC) out.put(c);
+    out.put<uint32_t>(CHECKPOINT_VERSION);
+    out.putString(Metric::name());
+    out.put<uint32_t>(sizeof(T));
+    out.put<uint64_t>(m_main_graph.size());
+    out.put<uint64_t>(m_main_graph.contentHash());
+
+    out.putBlob(m_smo_state);
+    out.put<uint32_t>(m_records.size());
+    for (const auto& record : m_records) {
+        out.putVector(record.indices);
+        out.put<uint8_t>(record.complete ? 1 : 0);
+        out.put<int32_t>(record.aco_iterations);
+        out.put(record.length);
+        out.putVector(record.route);
+        out.putBlob(record.aco_state);
+    }
 }
 
-std::vector<std::vector<int>> Hybrid::getRoutes() const {
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::loadCheckpoint(const std::string& path) {
+    // Kept mapped while any restored state blob still points into it
+    std::shared_ptr<CheckpointReader> reader = std::make_shared<CheckpointReader>(path);
+    CheckpointReader& in = *reader;
+
+    for (char c : CHECKPOINT_MAGIC) {
+        if (in.get<char>() != c)
+            throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    if (in.get<uint32_t>() != CHECKPOINT_VERSION)
+        throw std::runtime_error("Unsupported checkpoint version: " + path);
+    if (in.getString() != Metric::name() || in.get<uint32_t>() != sizeof(T))
+        throw std::runtime_error("Checkpoint was taken with a different metric/precision: " + path);
+    if (in.get<uint64_t>() != (uint64_t)m_main_graph.size() || in.get<uint64_t>() != m_main_graph.contentHash())
+        throw std::runtime_error("Checkpoint was taken on a different set of points: " + path);
+
+    size_t size;
+    const char* data = in.viewBlob(size);
+    CheckpointBlob smo_state(reader, data, size);
+    std::vector<ClusterRecord> records(in.get<uint32_t>());
+    for (auto& record : records) {
+        in.getVector(record.indices);
+        record.complete = in.get<uint8_t>() != 0;
+        record.aco_iterations = in.get<int32_t>();
+        record.length = in.get<double>();
+        in.getVector(record.route);
+        data = in.viewBlob(size);
+        record.aco_state = CheckpointBlob(reader, data, size);
+    }
+
+    m_smo_state = smo_state;
+    m_records.swap(records);
+    m_resume = true;
+    std::cout << "Loaded checkpoint " << path << std::endl;
+}
+
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::saveCheckpoint(const std::string& path) {
+    writeCheckpoint(path, false);
+}
+
+template <typename Metric, typename T>
+void Hybrid<Metric, T>::requestCheckpoint() {
+    if (m_checkpoint_path.empty())
+        throw std::runtime_error("requestCheckpoint needs checkpoint_path to be set");
+    m_checkpoint_requested = true;
+}
+
+template <typename Metric, typename T>
+std::vector<std::vector<int>> Hybrid<Metric, T>::getRoutes() const {
     return m_final_routes;
 }
 
-double Hybrid::getTotalLength() const {
+template <typename Metric, typename T>
+double Hybrid<Metric, T>::getTotalLength() const {
     return m_total_length;
-}
\ No newline at end of file
+}
+
+#define INSTANTIATE_HYBRID(M, T) template class Hybrid<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_HYBRID)
+#undef INSTANTIATE_HYBRID
@@ -0,0 +1,147 @@
+#include "inter_route.hpp"
+#include <algorithm>
+
+template <typename Metric, typename T>
+InterRoute<Metric, T>::InterRoute(const Graph<Metric, T>& g, int num_neighbors, int max_segment) :
+    graph(g),
+    num_neighbors(std::min(num_neighbors, g.getNumNeighbors())),
+    max_segment(std::max(1, max_segment))
+{
+}
+
+// Cost of the edges around `gap` once it holds `content` (which may be empty).
+template <typename Metric, typename T>
+double InterRoute<Metric, T>::gapCost(const Segment& gap, const Segment& content) const {
+    const std::vector<int>& tour = tours[gap.route];
+    int p = tour[gap.begin - 1];
+    int q = tour[gap.end % tour.size()];
+    if (content.begin == content.end)
+        return graph.getDistance(p, q);
+    const std::vector<int>& src = tours[content.route];
+    return graph.getDistance(p, src[content.begin]) + graph.getDistance(src[content.end - 1], q);
+}
+
+// Segment interiors are unchanged (metrics are symmetric), so only the four
+// boundary edges matter.
+template <typename Metric, typename T>
+double InterRoute<Metric, T>::exchangeDelta(const Segment& a, const Segment& b) const {
+    return gapCost(a, b) + gapCost(b, a) - gapCost(a, a) - gapCost(b, b);
+}
+
+template <typename Metric, typename T>
+void InterRoute<Metric, T>::applyExchange(const Segment& a, const Segment& b) {
+    const std::vector<int>& ta = tours[a.route];
+    const std::vector<int>& tb = tours[b.route];
+
+    std::vector<int> new_a(ta.begin(), ta.begin() + a.begin);
+    new_a.insert(new_a.end(), tb.begin() + b.begin, tb.begin() + b.end);
+    new_a.insert(new_a.end(), ta.begin() + a.end, ta.end());
+
+    std::vector<int> new_b(tb.begin(), tb.begin() + b.begin);
+    new_b.insert(new_b.end(), ta.begin() + a.begin, ta.begin() + a.end);
+    new_b.insert(new_b.end(), tb.begin() + b.end, tb.end());
+
+    tours[a.route].swap(new_a);
+    tours[b.route].swap(new_b);
+    reindex(a.route);
+    reindex(b.route);
+}
+
+template <typename Metric, typename T>
+void InterRoute<Metric, T>::reindex(int r) {
+    for (int i = 0; i < (int)tours[r].size(); ++i) {
+        route_of[tours[r][i]] = r;
+        pos_of[tours[r][i]] = i;
+    }
+}
+
+// Tries every move pairing u with a nearby city of another route and applies
+// the best improving one.
+template <typename Metric, typename T>
+bool InterRoute<Metric, T>::improveCity(int u) {
+    int ra = route_of[u];
+    int i = pos_of[u];
+    if (ra < 0 || i == 0) return false; // route anchors stay put
+
+    int ka = tours[ra].size();
+    const int* nbrs = graph.getNeighbors(u);
+    std::vector<std::pair<Segment, Segment>> moves;
+    for (int n = 0; n < num_neighbors; ++n) {
+        int v = nbrs[n];
+        int rb = route_of[v];
+        if (rb < 0 || rb == ra) continue;
+        int j = pos_of[v];
+        int kb = tours[rb].size();
+
+        moves.clear();
+        Segment city_u = {ra, i, i + 1};
+        // Relocate u right after v, or right before it
+        moves.push_back(std::make_pair(city_u, Segment{rb, j + 1, j + 1}));
+        if (j > 0)
+            moves.push_back(std::make_pair(city_u, Segment{rb, j, j}));
+        // Swap (1, 1) and cross-exchange of segments starting at u and v
+        if (j > 0) {
+            for (int la = 1; la <= max_segment && i + la <= ka; ++la)
+                for (int lb = 1; lb <= max_segment && j + lb <= kb; ++lb)
+                    moves.push_back(std::make_pair(Segment{ra, i, i + la}, Segment{rb, j, j + lb}));
+        }
+        // 2-opt*: u's tail follows v, or takes the place of v's tail
+        moves.push_back(std::make_pair(Segment{ra, i, ka}, Segment{rb, j + 1, kb}));
+        if (j > 0)
+            moves.push_back(std::make_pair(Segment{ra, i, ka}, Segment{rb, j, kb}));
+
+        double best_delta = -1e-9;
+        int best = -1;
+        for (int m = 0; m < (int)moves.size(); ++m) {
+            double delta = exchangeDelta(moves[m].first, moves[m].second);
+            if (delta < best_delta) {
+                best_delta = delta;
+                best = m;
+            }
+        }
+        if (best >= 0) {
+            applyExchange(moves[best].first, moves[best].second);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Metric, typename T>
+double InterRoute<Metric, T>::improve(std::vector<std::vector<int>>& routes, int max_passes) {
+    int n = graph.size();
+    tours.assign(routes.size(), std::vector<int>());
+    route_of.assign(n, -1);
+    pos_of.assign(n, -1);
+
+    double before = 0.0;
+    for (int r = 0; r < (int)routes.size(); ++r) {
+        if (routes[r].empty()) continue;
+        tours[r].assign(routes[r].begin(), routes[r].end() - 1);
+        reindex(r);
+        for (int i = 0; i + 1 < (int)routes[r].size(); ++i)
+            before += graph.getDistance(routes[r][i], routes[r][i + 1]);
+    }
+
+    bool improved = true;
+    for (int pass = 0; improved && pass < max_passes; ++pass) {
+        improved = false;
+        for (int u = 0; u < n; ++u) {
+            if (improveCity(u)) improved = true;
+        }
+    }
+
+    double after = 0.0;
+    for (int r = 0; r < (int)routes.size(); ++r) {
+        if (routes[r].empty()) continue;
+        routes[r] = tours[r];
+        routes[r].push_back(tours[r][0]);
+        for (int i = 0; i + 1 < (int)routes[r].size(); ++i)
+            after += graph.getDistance(routes[r][i], routes[r][i + 1]);
+    }
+    return before - after;
+}
+
+#define INSTANTIATE_INTER_ROUTE(M, T) template class InterRoute<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_INTER_ROUTE)
+#undef INSTANTIATE_INTER_ROUTE
@@ -0,0 +1,106 @@
+#include "island_aco.hpp"
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+template <typename Metric, typename T>
+IslandACO<Metric, T>::IslandACO(const Graph<Metric, T>& g, int ants,
+        double alpha, double beta, double rho, double Q,
+        int num_islands, int migration_interval) :
+        migration_interval(std::max(1, migration_interval))
+{
+    num_islands = std::max(1, num_islands);
+    g.nearest_neighbor_tour_length(); // computed once, before the islands share `g` across threads
+    islands.reserve(num_islands);
+    for (int i = 0; i < num_islands; ++i) {
+        islands.emplace_back(new ACO<Metric, T>(g, ants, alpha, beta, rho, Q));
+    }
+}
+
+template <typename Metric, typename T>
+int IslandACO<Metric, T>::best_island() const {
+    int best = 0;
+    for (int i = 1; i < (int)islands.size(); ++i) {
+        if (islands[i]->best_distance() < islands[best]->best_distance())
+            best = i;
+    }
+    return best;
+}
+
+template <typename Metric, typename T>
+void IslandACO<Metric, T>::migrate() {
+    int src = best_island();
+    std::vector<int> tour = islands[src]->final_route();
+    tour.pop_back(); // drop the closing return to city 0
+    double length = islands[src]->best_distance();
+
+    for (int i = 0; i < (int)islands.size(); ++i) {
+        if (i != src)
+            islands[i]->accept_migrant(tour, length);
+    }
+}
+
+template <typename Metric, typename T>
+void IslandACO<Metric, T>::run(int iterations, const std::function<void()>& on_epoch) {
+    int done = islands[0]->iterations();
+    while (done < iterations) {
+        int epoch = std::min(migration_interval, iterations - done);
+
+        std::vector<std::thread> workers;
+        workers.reserve(islands.size());
+        for (auto& island : islands) {
+            ACO<Metric, T>* colony = island.get();
+            workers.emplace_back([colony, epoch]() {
+                for (int i = 0; i < epoch; ++i)
+                    colony->step();
+            });
+        }
+        for (auto& w : workers) w.join();
+
+        done += epoch;
+        migrate();
+        std::cout << "Iteration " << done - 1 << " best length (" << islands.size()
+                  << " islands): " << best_distance() << "\n";
+        if (on_epoch) on_epoch();
+    }
+}
+
+template <typename Metric, typename T>
+std::vector<int> IslandACO<Metric, T>::final_route() const {
+    return islands[best_island()]->final_route();
+}
+
+template <typename Metric, typename T>
+double IslandACO<Metric, T>::best_distance() const {
+    return islands[best_island()]->best_distance();
+}
+
+template <typename Metric, typename T>
+void IslandACO<Metric, T>::save(CheckpointWriter& out) const {
+    out.put<uint32_t>(islands.size());
+    for (const auto& island : islands) {
+        CheckpointWriter colony;
+        island->save(colony);
+        out.putBlob(colony.buffer());
+    }
+}
+
+template <typename Metric, typename T>
+void IslandACO<Metric, T>::load(CheckpointReader& in) {
+    uint32_t count = in.get<uint32_t>();
+    if (count == 0)
+        throw std::runtime_error("Island checkpoint has no colonies");
+    std::vector<std::vector<char>> colonies(count);
+    for (auto& colony : colonies) colony = in.getBlob();
+
+    for (int i = 0; i < (int)islands.size(); ++i) {
+        const std::vector<char>& colony = colonies[i % count];
+        CheckpointReader reader(colony.data(), colony.size());
+        islands[i]->load(reader);
+    }
+}
+
+#define INSTANTIATE_ISLAND_ACO(M, T) template class IslandACO<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_ISLAND_ACO)
+#undef INSTANTIATE_ISLAND_ACO
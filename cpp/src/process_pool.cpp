@@ -0,0 +1,211 @@
+#include "process_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+static std::atomic<unsigned> segment_counter(0);
+
+SharedSegment::SharedSegment(size_t size)
+    : m_data(nullptr), m_size(size)
+{
+    int fd = -1;
+    for (int attempt = 0; attempt < 16 && fd < 0; ++attempt) {
+        m_name = "/mtsp_" + std::to_string(::getpid()) + "_" + std::to_string(segment_counter++);
+        fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 && errno != EEXIST)
+            break;
+    }
+    if (fd < 0)
+        throw std::runtime_error("Cannot create shared memory segment: " + std::string(std::strerror(errno)));
+
+    if (::ftruncate(fd, m_size > 0 ? m_size : 1) != 0) {
+        ::close(fd);
+        ::shm_unlink(m_name.c_str());
+        throw std::runtime_error("Cannot size shared memory segment " + m_name);
+    }
+    void* p = ::mmap(nullptr, m_size > 0 ? m_size : 1, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        ::shm_unlink(m_name.c_str());
+        throw std::runtime_error("Cannot map shared memory segment " + m_name);
+    }
+    m_data = static_cast<char*>(p);
+}
+
+SharedSegment::~SharedSegment() {
+    ::munmap(m_data, m_size > 0 ? m_size : 1);
+    ::shm_unlink(m_name.c_str());
+}
+
+static bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t w = ::write(fd, data, len);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += w;
+        len -= w;
+    }
+    return true;
+}
+
+// Runs in the forked child; never returns.
+static void workerMain(int index, int fd, const std::function<std::vector<char>(int)>& body) {
+    int status = 0;
+    try {
+        std::vector<char> out = body(index);
+        uint64_t size = out.size();
+        if (!writeAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) ||
+            !writeAll(fd, out.data(), out.size()))
+            status = 2;
+    } catch (const std::exception& e) {
+        std::cerr << "Worker " << index << " failed: " << e.what() << std::endl;
+        status = 1;
+    } catch (...) {
+        status = 1;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    ::close(fd);
+    // Skip atexit handlers and static destructors that belong to the parent
+    ::_exit(status);
+}
+
+std::vector<WorkerResult> runWorkers(int count, const std::function<std::vector<char>(int)>& body) {
+    std::vector<WorkerResult> results(count);
+    std::vector<pid_t> pids(count, -1);
+    std::vector<int> fds(count, -1);
+
+    // Anything still buffered would otherwise be printed once per worker
+    std::cout.flush();
+    std::cerr.flush();
+
+    for (int w = 0; w < count; ++w) {
+        int pipefd[2];
+        if (::pipe(pipefd) != 0) {
+            results[w].error = "cannot create pipe";
+            continue;
+        }
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            ::close(pipefd[0]);
+            ::close(pipefd[1]);
+            results[w].error = "fork failed";
+            continue;
+        }
+        if (pid == 0) {
+            ::close(pipefd[0]);
+            for (int j = 0; j < w; ++j) {
+                if (fds[j] >= 0)
+                    ::close(fds[j]);
+            }
+            workerMain(w, pipefd[1], body);
+        }
+        ::close(pipefd[1]);
+        pids[w] = pid;
+        fds[w] = pipefd[0];
+    }
+
+    // Drain all pipes concurrently so no worker blocks on a full pipe
+    int open_count = 0;
+    for (int fd : fds) {
+        if (fd >= 0)
+            ++open_count;
+    }
+    char chunk[65536];
+    while (open_count > 0) {
+        std::vector<pollfd> polled;
+        std::vector<int> owners;
+        for (int w = 0; w < count; ++w) {
+            if (fds[w] < 0)
+                continue;
+            pollfd p;
+            p.fd = fds[w];
+            p.events = POLLIN;
+            p.revents = 0;
+            polled.push_back(p);
+            owners.push_back(w);
+        }
+        if (::poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("poll failed while waiting for workers");
+        }
+        for (size_t k = 0; k < polled.size(); ++k) {
+            if (polled[k].revents == 0)
+                continue;
+            int w = owners[k];
+            ssize_t r = ::read(fds[w], chunk, sizeof(chunk));
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r > 0) {
+                results[w].output.insert(results[w].output.end(), chunk, chunk + r);
+                continue;
+            }
+            ::close(fds[w]);
+            fds[w] = -1;
+            --open_count;
+        }
+    }
+
+    for (int w = 0; w < count; ++w) {
+        if (pids[w] < 0)
+            continue;
+        int status = 0;
+        while (::waitpid(pids[w], &status, 0) < 0 && errno == EINTR) {}
+
+        WorkerResult& result = results[w];
+        if (WIFSIGNALED(status)) {
+            result.error = "killed by signal " + std::to_string(WTERMSIG(status));
+        } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            result.error = "exited with status " + std::to_string(WEXITSTATUS(status));
+        } else {
+            uint64_t size = 0;
+            if (result.output.size() >= sizeof(size))
+                std::memcpy(&size, result.output.data(), sizeof(size));
+            if (result.output.size() < sizeof(size) || size != result.output.size() - sizeof(size)) {
+                result.error = "returned incomplete output";
+            } else {
+                result.output.erase(result.output.begin(), result.output.begin() + sizeof(size));
+                result.ok = true;
+            }
+        }
+        if (!result.ok)
+            result.output.clear();
+    }
+    return results;
+}
+
+#else
+
+SharedSegment::SharedSegment(size_t size)
+    : m_data(nullptr), m_size(size)
+{
+    throw std::runtime_error("Shared memory workers are not supported on this platform");
+}
+
+SharedSegment::~SharedSegment() {
+}
+
+std::vector<WorkerResult> runWorkers(int count, const std::function<std::vector<char>(int)>& body) {
+    throw std::runtime_error("Worker processes are not supported on this platform");
+}
+
+#endif
@@ -2,15 +2,55 @@
 #include <pybind11/stl.h> 
 
 #include "hybrid.hpp" 
+#include <stdexcept>
+#include <string>
 
 namespace py = pybind11;
 
+// Maps the runtime (metric, precision) pair onto one of the explicitly
+// instantiated Hybrid<Metric, T> specializations.
+static HybridBase* make_hybrid(const std::vector<std::pair<double,double>>& pts,
+                               int num_salesmen, int smo_iterations,
+                               int smo_population_size, int smo_local_limit,
+                               int smo_global_limit, double smo_pr,
+                               int aco_ants, int aco_iterations,
+                               double aco_alpha, double aco_beta,
+                               double aco_rho, double aco_Q,
+                               int aco_islands, int aco_migration_interval,
+                               const std::string& checkpoint_path,
+                               double checkpoint_interval,
+                               int smo_sample_size, bool smo_kmeans_pp,
+                               int smo_lloyd_interval, int smo_lloyd_steps,
+                               const std::string& instance_cache,
+                               bool cache_distances,
+                               bool improve_routes, int improve_neighbors,
+                               int improve_max_segment,
+                               int worker_processes,
+                               const std::string& metric,
+                               const std::string& precision) {
+#define MAKE_HYBRID(M, T)                                                      \
+    if (metric == M::name() && precision == #T)                                \
+        return new Hybrid<M, T>(pts, num_salesmen, smo_iterations,             \
+                                smo_population_size, smo_local_limit,          \
+                                smo_global_limit, smo_pr, aco_ants,            \
+                                aco_iterations, aco_alpha, aco_beta,           \
+                                aco_rho, aco_Q, aco_islands,                   \
+                                aco_migration_interval, checkpoint_path,       \
+                                checkpoint_interval, smo_sample_size,          \
+                                smo_kmeans_pp, smo_lloyd_interval,             \
+                                smo_lloyd_steps, instance_cache,               \
+                                cache_distances, improve_routes,               \
+                                improve_neighbors, improve_max_segment,        \
+                                worker_processes);
+    MTSP_FOR_EACH_POLICY(MAKE_HYBRID)
+#undef MAKE_HYBRID
+    throw std::invalid_argument("Unsupported metric/precision: " + metric + "/" + precision);
+}
+
 PYBIND11_MODULE(MTSP_SOLVER, m) {
     m.doc() = "Hybrid m-TSP solver using SMO clustering and ACO routing";
-    py::class_<Hybrid>(m, "Hybrid")
-        .def(py::init<const std::vector<std::pair<double,double>>&,
-                    int, int, int, int, int, double,
-                    int, int, double, double, double, double>(),
+    py::class_<HybridBase>(m, "Hybrid")
+        .def(py::init(&make_hybrid),
             py::arg("pts"),
             py::arg("num_salesmen"),
             py::arg("smo_iterations"),
@@ -23,14 +63,53 @@ PYBIND11_MODULE(MTSP_SOLVER, m) {
             py::arg("aco_alpha") = 1.0,
             py::arg("aco_beta") = 5.0,
             py::arg("aco_rho") = 0.5,
-            py::arg("aco_Q") = 100.0)
+            py::arg("aco_Q") = 100.0,
+            py::arg("aco_islands") = 1,
+            py::arg("aco_migration_interval") = 25,
+            py::arg("checkpoint_path") = "",
+            py::arg("checkpoint_interval") = 0.0,
+            py::arg("smo_sample_size") = 0,
+            py::arg("smo_kmeans_pp") = false,
+            py::arg("smo_lloyd_interval") = 0,
+            py::arg("smo_lloyd_steps") = 3,
+            py::arg("instance_cache") = "",
+            py::arg("cache_distances") = true,
+            py::arg("improve_routes") = false,
+            py::arg("improve_neighbors") = 10,
+            py::arg("improve_max_segment") = 3,
+            py::arg("worker_processes") = 0,
+            py::arg("metric") = "euclidean",
+            py::arg("precision") = "double",
+            "metric: euclidean, manhattan, euc_2d, att, geo or haversine; "
+            "precision: double or float; aco_islands > 1 runs that many "
+            "colonies in parallel, exchanging best tours every "
+            "aco_migration_interval iterations; with checkpoint_path set, state "
+            "is written there every checkpoint_interval seconds (0 = only at the end); "
+            "smo_sample_size > 0 scores SMO candidates on a weighted sample of that size; "
+            "smo_kmeans_pp seeds the population with k-means++ and smo_lloyd_interval > 0 "
+            "refines leaders with smo_lloyd_steps Lloyd iterations that often; "
+            "instance_cache names a binary file holding the distance matrix (if "
+            "cache_distances), neighbor lists and bounds, rebuilt when the points change; "
+            "improve_routes applies relocate/swap/2-opt*/cross-exchange moves between "
+            "routes, pairing each city with its improve_neighbors nearest neighbors; "
+            "worker_processes > 0 routes clusters in that many forked processes, so a "
+            "crashing worker raises an error instead of killing the interpreter (POSIX only)")
         
-        .def("run", &Hybrid::run, 
+        .def("run", &HybridBase::run, py::call_guard<py::gil_scoped_release>(),
              "Runs the full SMO clustering and ACO routing pipeline")
         
-        .def("get_routes", &Hybrid::getRoutes, 
+        .def("get_routes", &HybridBase::getRoutes, 
              "Returns a list of routes (one list per salesman)")
         
-        .def("get_total_length", &Hybrid::getTotalLength, 
-             "Returns the sum of all route lengths");
+        .def("get_total_length", &HybridBase::getTotalLength, 
+             "Returns the sum of all route lengths")
+
+        .def("load_checkpoint", &HybridBase::loadCheckpoint, py::arg("path"),
+             "Resumes (or warm-starts) from a checkpoint; call before run()")
+
+        .def("save_checkpoint", &HybridBase::saveCheckpoint, py::arg("path"),
+             "Writes the current solver state to a checkpoint file")
+
+        .def("request_checkpoint", &HybridBase::requestCheckpoint,
+             "Asks a running solve to write checkpoint_path at its next iteration");
 }
@@ -1,12 +1,15 @@
 #include "smo.hpp"
 #include <iostream>
 #include <limits>
+#include <stdexcept>
 #include <cmath>
 #include <algorithm> 
 
-SMO::SMO(int num_clusters, int iterations, const Graph& g,
+template <typename Metric, typename T>
+SMO<Metric, T>::SMO(int num_clusters, int iterations, const Graph<Metric, T>& g,
          int population_size, int local_leader_limit,
-         int global_leader_limit, double pr)
+         int global_leader_limit, double pr, int sample_size,
+         bool kmeans_pp, int lloyd_interval, int lloyd_steps)
     : m_num_clusters(num_clusters),
       m_iterations(iterations),
       m_graph(g),
@@ -14,120 +17,312 @@ SMO::SMO(int num_clusters, int iterations, const Graph& g,
       m_local_leader_limit(local_leader_limit),
       m_global_leader_limit(global_leader_limit),
       m_pr(pr),
+      m_sample_size(sample_size),
+      m_kmeans_pp(kmeans_pp),
+      m_lloyd_interval(lloyd_interval),
+      m_lloyd_steps(lloyd_steps),
       m_global_leader_fitness(std::numeric_limits<double>::max()),
       m_global_leader_limit_count(0),
       m_num_groups(1),
+      m_completed_iterations(0),
+      m_restored(false),
       m_rng(std::random_device{}()) 
 {
 }
 
-void SMO::initialize() {
-    // Find graph bounds to initialize positions
-    m_x_bounds = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
-    m_y_bounds = {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
-    for (const auto& pt : m_graph.getPoints()) {
-        if (pt.first < m_x_bounds.first) m_x_bounds.first = pt.first;
-        if (pt.first > m_x_bounds.second) m_x_bounds.second = pt.first;
-        if (pt.second < m_y_bounds.first) m_y_bounds.first = pt.second;
-        if (pt.second > m_y_bounds.second) m_y_bounds.second = pt.second;
-    }
+template <typename Metric, typename T>
+void SMO<Metric, T>::initialize() {
+    // Graph bounds to initialize positions
+    m_x_bounds = m_graph.getXBounds();
+    m_y_bounds = m_graph.getYBounds();
+
+    buildSample();
 
     // Initialize distributions
-    std::uniform_real_distribution<double> dist_x(m_x_bounds.first, m_x_bounds.second);
-    std::uniform_real_distribution<double> dist_y(m_y_bounds.first, m_y_bounds.second);
+    std::uniform_real_distribution<T> dist_x(m_x_bounds.first, m_x_bounds.second);
+    std::uniform_real_distribution<T> dist_y(m_y_bounds.first, m_y_bounds.second);
 
     // Initialize population
-    m_population.assign(m_population_size, std::vector<std::pair<double, double>>(m_num_clusters));
+    m_population.assign(m_population_size, std::vector<Point>(m_num_clusters));
     m_fitness.assign(m_population_size, std::numeric_limits<double>::max());
     m_group_id.assign(m_population_size, 0); 
 
     // Local leaders
-    m_local_leaders.assign(1, std::vector<std::pair<double, double>>(m_num_clusters)); 
+    m_local_leaders.assign(1, std::vector<Point>(m_num_clusters)); 
     m_local_leader_fitness.assign(1, std::numeric_limits<double>::max());
+    m_local_leader_exact.assign(1, std::numeric_limits<double>::max());
     m_local_leader_limit_count.assign(1, 0);
     m_global_leader.resize(m_num_clusters); 
 
+    int best = 0;
     for (int i = 0; i < m_population_size; ++i) {
-        for (int j = 0; j < m_num_clusters; ++j) {
-            m_population[i][j].first = dist_x(m_rng);     
-            m_population[i][j].second = dist_y(m_rng);    
+        if (m_kmeans_pp) {
+            seedKMeansPP(m_population[i]);
+        } else {
+            for (int j = 0; j < m_num_clusters; ++j) {
+                m_population[i][j].first = dist_x(m_rng);     
+                m_population[i][j].second = dist_y(m_rng);    
+            }
         }
         m_fitness[i] = calculateFitness(m_population[i]);
-
-        // Update Global Leader
-        if (m_fitness[i] < m_global_leader_fitness) {
-            m_global_leader_fitness = m_fitness[i];
-            m_global_leader = m_population[i];
-        }
+        if (m_fitness[i] < m_fitness[best]) best = i;
     }
+
+    // Global leader is promoted on exact fitness
+    m_global_leader = m_population[best];
+    m_global_leader_fitness = exactFitness(m_global_leader);
     
     // Set initial local leader (just copy global leader for group 0)
     m_local_leaders[0] = m_global_leader;
-    m_local_leader_fitness[0] = m_global_leader_fitness;
+    m_local_leader_fitness[0] = m_fitness[best];
+    m_local_leader_exact[0] = m_global_leader_fitness;
+}
+
+// Stratified sample: the bounding box is split into a grid and every
+// non-empty cell contributes points in proportion to its population, each
+// weighted by cell_count / cell_samples so weights sum to the point count.
+template <typename Metric, typename T>
+void SMO<Metric, T>::buildSample() {
+    m_sample.clear();
+    m_sample_weight.clear();
+    const auto& points = m_graph.getPoints();
+    int n = points.size();
+    if (m_sample_size <= 0 || m_sample_size >= n) return;
+
+    int side = std::max(1, (int)std::sqrt(m_sample_size / 8.0));
+    double width = m_x_bounds.second - m_x_bounds.first;
+    double height = m_y_bounds.second - m_y_bounds.first;
+    std::vector<std::vector<int>> cells(side * side);
+    for (int i = 0; i < n; ++i) {
+        int cx = width > 0 ? std::min(side - 1, (int)((points[i].first - m_x_bounds.first) / width * side)) : 0;
+        int cy = height > 0 ? std::min(side - 1, (int)((points[i].second - m_y_bounds.first) / height * side)) : 0;
+        cells[cy * side + cx].push_back(i);
+    }
+
+    double rate = (double)m_sample_size / n;
+    for (auto& cell : cells) {
+        int count = cell.size();
+        if (count == 0) continue;
+        int take = std::min(count, std::max(1, (int)(count * rate + 0.5)));
+        for (int k = 0; k < take; ++k) {
+            int pick = std::uniform_int_distribution<int>(k, count - 1)(m_rng);
+            std::swap(cell[k], cell[pick]);
+            m_sample.push_back(points[cell[k]]);
+            m_sample_weight.push_back((double)count / take);
+        }
+    }
 }
 
-double SMO::calculateFitness(const std::vector<std::pair<double, double>>& position) {
-    std::vector<std::vector<int>> clusters; // Dummy variable
-    return assignPointsToClusters(position, clusters);
+template <typename Metric, typename T>
+int SMO<Metric, T>::nearestCentroid(const Point& point, const std::vector<Point>& position,
+                                    double& cost) const {
+    cost = std::numeric_limits<double>::max();
+    int best_cluster = 0;
+    for (int j = 0; j < m_num_clusters; ++j) {
+        double dist_sq = Metric::cluster_cost(point, position[j]);
+        if (dist_sq < cost) {
+            cost = dist_sq;
+            best_cluster = j;
+        }
+    }
+    return best_cluster;
 }
 
-double SMO::assignPointsToClusters(const std::vector<std::pair<double, double>>& position,
-                                   std::vector<std::vector<int>>& clusters) const {
-    clusters.assign(m_num_clusters, std::vector<int>());
+template <typename Metric, typename T>
+double SMO<Metric, T>::exactFitness(const std::vector<Point>& position) const {
     double total_sse = 0.0;
-    const auto& points = m_graph.getPoints();
+    double cost;
+    for (const auto& point : m_graph.getPoints()) {
+        nearestCentroid(point, position, cost);
+        total_sse += cost;
+    }
+    return total_sse;
+}
 
-    for (int i = 0; i < points.size(); ++i) {
-        double min_dist_sq = std::numeric_limits<double>::max();
-        int best_cluster = 0;
+template <typename Metric, typename T>
+double SMO<Metric, T>::calculateFitness(const std::vector<Point>& position) {
+    if (m_sample.empty())
+        return exactFitness(position);
 
-        for (int j = 0; j < m_num_clusters; ++j) {
-            double dx = points[i].first - position[j].first;
-            double dy = points[i].second - position[j].second;
-            double dist_sq = dx * dx + dy * dy;
+    double total_sse = 0.0;
+    double cost;
+    for (int i = 0; i < (int)m_sample.size(); ++i) {
+        nearestCentroid(m_sample[i], position, cost);
+        total_sse += m_sample_weight[i] * cost;
+    }
+    return total_sse;
+}
+
+// k-means++ (D^2) seeding over the fitness sample, or all points without one.
+template <typename Metric, typename T>
+void SMO<Metric, T>::seedKMeansPP(std::vector<Point>& position) {
+    const std::vector<Point>& points = m_sample.empty() ? m_graph.getPoints() : m_sample;
+    int n = points.size();
+    std::vector<double> weight(n, 1.0);
+    if (!m_sample.empty()) weight = m_sample_weight;
+
+    std::vector<double> d2(n, 1.0);
+    std::uniform_real_distribution<double> rand_01(0.0, 1.0);
+    for (int j = 0; j < m_num_clusters; ++j) {
+        double total = 0.0;
+        for (int i = 0; i < n; ++i) total += weight[i] * d2[i];
 
-            if (dist_sq < min_dist_sq) {
-                min_dist_sq = dist_sq;
-                best_cluster = j;
+        int pick = n - 1;
+        if (total > 0.0) {
+            double r = rand_01(m_rng) * total;
+            double cumulative = 0.0;
+            for (int i = 0; i < n; ++i) {
+                cumulative += weight[i] * d2[i];
+                if (r <= cumulative) {
+                    pick = i;
+                    break;
+                }
             }
+        } else {
+            pick = std::uniform_int_distribution<int>(0, n - 1)(m_rng);
+        }
+        position[j] = points[pick];
+
+        for (int i = 0; i < n; ++i) {
+            double cost = Metric::cluster_cost(points[i], position[j]);
+            if (j == 0 || cost < d2[i]) d2[i] = cost;
         }
+    }
+}
+
+// A few Lloyd (k-means) steps on all points; returns the exact fitness after.
+// A centroid that attracts no points is moved onto the worst-served point.
+template <typename Metric, typename T>
+double SMO<Metric, T>::lloydRefine(std::vector<Point>& position) {
+    const auto& points = m_graph.getPoints();
+    int n = points.size();
+    std::vector<double> sum_x(m_num_clusters), sum_y(m_num_clusters);
+    std::vector<int> count(m_num_clusters);
+    std::vector<double> cost(n);
+
+    for (int step = 0; step < m_lloyd_steps; ++step) {
+        std::fill(sum_x.begin(), sum_x.end(), 0.0);
+        std::fill(sum_y.begin(), sum_y.end(), 0.0);
+        std::fill(count.begin(), count.end(), 0);
+        for (int i = 0; i < n; ++i) {
+            int j = nearestCentroid(points[i], position, cost[i]);
+            sum_x[j] += points[i].first;
+            sum_y[j] += points[i].second;
+            count[j]++;
+        }
+        for (int j = 0; j < m_num_clusters; ++j) {
+            if (count[j] == 0) {
+                int worst = std::max_element(cost.begin(), cost.end()) - cost.begin();
+                position[j] = points[worst];
+                cost[worst] = 0.0;
+                continue;
+            }
+            position[j].first = static_cast<T>(sum_x[j] / count[j]);
+            position[j].second = static_cast<T>(sum_y[j] / count[j]);
+            clampCentroid(position[j]);
+        }
+    }
+    return exactFitness(position);
+}
+
+// Memetic step: Lloyd-refine the best monkey of each group and the global
+// leader. Each group's leader is first synced to its best monkey (groups
+// created by a split this iteration have no leader yet), and a refined
+// leader replaces that monkey, so the improvement survives the next leader
+// selection.
+template <typename Metric, typename T>
+void SMO<Metric, T>::refineLeaders() {
+    for (int g = 0; g < m_num_groups; ++g) {
+        int best = -1;
+        for (int i = 0; i < m_population_size; ++i) {
+            if (m_group_id[i] == g && (best < 0 || m_fitness[i] < m_fitness[best]))
+                best = i;
+        }
+        if (best < 0) continue;
+
+        if (m_population[best] != m_local_leaders[g]) {
+            m_local_leaders[g] = m_population[best];
+            m_local_leader_exact[g] = exactFitness(m_population[best]);
+        }
+        m_local_leader_fitness[g] = m_fitness[best];
+
+        std::vector<Point> refined = m_local_leaders[g];
+        double fitness = lloydRefine(refined);
+        if (fitness < m_local_leader_exact[g]) {
+            m_local_leaders[g] = refined;
+            m_local_leader_exact[g] = fitness;
+            m_population[best] = refined;
+            m_fitness[best] = calculateFitness(refined);
+            m_local_leader_fitness[g] = m_fitness[best];
+        }
+    }
+
+    std::vector<Point> refined = m_global_leader;
+    double fitness = lloydRefine(refined);
+    if (fitness < m_global_leader_fitness) {
+        m_global_leader = refined;
+        m_global_leader_fitness = fitness;
+    }
+}
+
+template <typename Metric, typename T>
+double SMO<Metric, T>::assignPointsToClusters(const std::vector<Point>& position,
+                                   std::vector<std::vector<int>>& clusters) const {
+    clusters.assign(m_num_clusters, std::vector<int>());
+    double total_sse = 0.0;
+    const auto& points = m_graph.getPoints();
+
+    for (int i = 0; i < points.size(); ++i) {
+        double min_dist_sq;
+        int best_cluster = nearestCentroid(points[i], position, min_dist_sq);
         clusters[best_cluster].push_back(i); // Store original index
         total_sse += min_dist_sq;
     }
     return total_sse;
 }
 
-void SMO::clampCentroid(std::pair<double, double>& centroid) {
+template <typename Metric, typename T>
+void SMO<Metric, T>::clampCentroid(Point& centroid) {
     centroid.first = std::max(m_x_bounds.first, std::min(m_x_bounds.second, centroid.first));
     centroid.second = std::max(m_y_bounds.first, std::min(m_y_bounds.second, centroid.second));
 }
 
-void SMO::run() {
-    initialize();
-    
-    std::cout << "SMO Starting. Initial Best Fitness (SSE): " << m_global_leader_fitness << std::endl;
+template <typename Metric, typename T>
+void SMO<Metric, T>::run(const std::function<void()>& on_iteration) {
+    if (m_restored) {
+        std::cout << "SMO Resuming at iteration " << m_completed_iterations
+                  << ". Best Fitness (SSE): " << m_global_leader_fitness << std::endl;
+    } else {
+        initialize();
+        std::cout << "SMO Starting. Initial Best Fitness (SSE): " << m_global_leader_fitness << std::endl;
+    }
 
-    for (int iter = 0; iter < m_iterations; ++iter) {
+    for (int iter = m_completed_iterations; iter < m_iterations; ++iter) {
         localLeaderPhase();
         globalLeaderPhase();
         globalLeaderLearningPhase(); // Check if global leader is stagnant
         localLeaderLearningPhase();  // Check if local leaders are stagnant
         localLeaderDecisionPhase();  // Re-group if necessary
+        if (m_lloyd_interval > 0 && (iter + 1) % m_lloyd_interval == 0)
+            refineLeaders();
         
         if(iter % 20 == 0 || iter == m_iterations - 1) {
             std::cout << "SMO Iter " << iter << " | Groups: " << m_num_groups 
                       << " | Best Fitness (SSE): " << m_global_leader_fitness << std::endl;
         }
+        m_completed_iterations = iter + 1;
+        if (on_iteration) on_iteration();
     }
     std::cout << "SMO Finished. Final Best Fitness (SSE): " << m_global_leader_fitness << std::endl;
 }
 
-void SMO::localLeaderPhase() {
+template <typename Metric, typename T>
+void SMO<Metric, T>::localLeaderPhase() {
     std::uniform_real_distribution<double> rand_01(0.0, 1.0);
     
     for (int i = 0; i < m_population_size; ++i) {
         int group = m_group_id[i];
-        std::vector<std::pair<double, double>> new_pos = m_population[i];
+        std::vector<Point> new_pos = m_population[i];
         
         for (int j = 0; j < m_num_clusters; ++j) { // Iterate over each centroid
             double r = rand_01(m_rng);
@@ -156,7 +351,8 @@ void SMO::localLeaderPhase() {
     }
 }
 
-void SMO::globalLeaderPhase() {
+template <typename Metric, typename T>
+void SMO<Metric, T>::globalLeaderPhase() {
     std::vector<double> prob(m_population_size, 0.0);
     double max_fit = -1.0;
     for(double f : m_fitness) {
@@ -189,7 +385,7 @@ void SMO::globalLeaderPhase() {
         }
         if(selected_monkey == -1) selected_monkey = i; // Fallback
         
-        std::vector<std::pair<double, double>> new_pos = m_population[i];
+        std::vector<Point> new_pos = m_population[i];
 
         for (int j = 0; j < m_num_clusters; ++j) {
             double r_pr = rand_01(m_rng);
@@ -214,24 +410,33 @@ void SMO::globalLeaderPhase() {
     }
 }
 
-void SMO::globalLeaderLearningPhase() {
+template <typename Metric, typename T>
+void SMO<Metric, T>::globalLeaderLearningPhase() {
     // Update local leaders
-    std::fill(m_local_leader_fitness.begin(), m_local_leader_fitness.end(), std::numeric_limits<double>::max());
-    
+    std::vector<int> best(m_num_groups, -1);
     for (int i = 0; i < m_population_size; ++i) {
         int group = m_group_id[i];
-        if (m_fitness[i] < m_local_leader_fitness[group]) {
-            m_local_leader_fitness[group] = m_fitness[i];
-            m_local_leaders[group] = m_population[i];
+        if (best[group] < 0 || m_fitness[i] < m_fitness[best[group]])
+            best[group] = i;
+    }
+
+    for (int g = 0; g < m_num_groups; ++g) {
+        if (best[g] < 0) continue;
+        const std::vector<Point>& leader = m_population[best[g]];
+        m_local_leader_fitness[g] = m_fitness[best[g]];
+        if (leader != m_local_leaders[g]) {
+            m_local_leaders[g] = leader;
+            // Leaders are promoted on exact fitness when candidates are only sampled
+            m_local_leader_exact[g] = m_sample.empty() ? m_fitness[best[g]] : exactFitness(leader);
         }
     }
 
     // Update global leader
-    double best_local_fitness = m_local_leader_fitness[0];
+    double best_local_fitness = m_local_leader_exact[0];
     int best_local_leader_idx = 0;
     for (int g = 1; g < m_num_groups; ++g) {
-        if (m_local_leader_fitness[g] < best_local_fitness) {
-            best_local_fitness = m_local_leader_fitness[g];
+        if (m_local_leader_exact[g] < best_local_fitness) {
+            best_local_fitness = m_local_leader_exact[g];
             best_local_leader_idx = g;
         }
     }
@@ -245,7 +450,8 @@ void SMO::globalLeaderLearningPhase() {
     }
 }
 
-void SMO::localLeaderLearningPhase() {
+template <typename Metric, typename T>
+void SMO<Metric, T>::localLeaderLearningPhase() {
     for(int g = 0; g < m_num_groups; ++g) {
         bool local_leader_updated = false;
         // Check if any monkey in the group improved the local leader
@@ -264,7 +470,8 @@ void SMO::localLeaderLearningPhase() {
     }
 }
 
-void SMO::localLeaderDecisionPhase() {
+template <typename Metric, typename T>
+void SMO<Metric, T>::localLeaderDecisionPhase() {
     if (m_global_leader_limit_count > m_global_leader_limit) {
         // Global leader is stagnant, split into groups
         m_global_leader_limit_count = 0;
@@ -273,8 +480,9 @@ void SMO::localLeaderDecisionPhase() {
         if (m_num_groups < std::max(1, m_population_size / 5)) { 
             m_num_groups++;
             // Resize leader vectors
-            m_local_leaders.resize(m_num_groups, std::vector<std::pair<double, double>>(m_num_clusters));
+            m_local_leaders.resize(m_num_groups, std::vector<Point>(m_num_clusters));
             m_local_leader_fitness.resize(m_num_groups, std::numeric_limits<double>::max());
+            m_local_leader_exact.resize(m_num_groups, std::numeric_limits<double>::max());
             m_local_leader_limit_count.resize(m_num_groups, 0);
 
             // Re-assign monkeys to groups (simple split)
@@ -286,7 +494,8 @@ void SMO::localLeaderDecisionPhase() {
              // Max groups reached, merge all back to one
              m_num_groups = 1;
              m_local_leaders.resize(1, m_global_leader);
-             m_local_leader_fitness.resize(1, m_global_leader_fitness);
+             m_local_leader_fitness.resize(1);
+             m_local_leader_exact.resize(1);
              m_local_leader_limit_count.resize(1, 0);
              std::fill(m_group_id.begin(), m_group_id.end(), 0);
         }
@@ -313,9 +522,74 @@ void SMO::localLeaderDecisionPhase() {
     }
 }
 
-std::vector<std::vector<int>> SMO::getClusters() const {
+template <typename Metric, typename T>
+std::vector<std::vector<int>> SMO<Metric, T>::getClusters() const {
     std::vector<std::vector<int>> final_clusters;
     // Assign all points one last time based on the best-ever solution
     assignPointsToClusters(m_global_leader, final_clusters);
     return final_clusters;
-}
\ No newline at end of file
+}
+
+template <typename Metric, typename T>
+void SMO<Metric, T>::save(CheckpointWriter& out) const {
+    out.put<int32_t>(m_num_clusters);
+    out.put<int32_t>(m_population_size);
+    out.put<int32_t>(m_completed_iterations);
+    out.put(m_x_bounds.first);
+    out.put(m_x_bounds.second);
+    out.put(m_y_bounds.first);
+    out.put(m_y_bounds.second);
+
+    for (const auto& monkey : m_population) out.putPoints(monkey);
+    out.putVector(m_fitness);
+    out.putVector(m_group_id);
+    out.put<int32_t>(m_num_groups);
+
+    for (const auto& leader : m_local_leaders) out.putPoints(leader);
+    out.putVector(m_local_leader_fitness);
+    out.putVector(m_local_leader_exact);
+    out.putVector(m_local_leader_limit_count);
+
+    out.putPoints(m_global_leader);
+    out.put(m_global_leader_fitness);
+    out.put<int32_t>(m_global_leader_limit_count);
+}
+
+template <typename Metric, typename T>
+void SMO<Metric, T>::load(CheckpointReader& in) {
+    if (in.get<int32_t>() != m_num_clusters || in.get<int32_t>() != m_population_size)
+        throw std::runtime_error("SMO checkpoint does not match num_salesmen/population size");
+
+    m_completed_iterations = in.get<int32_t>();
+    m_x_bounds.first = in.get<T>();
+    m_x_bounds.second = in.get<T>();
+    m_y_bounds.first = in.get<T>();
+    m_y_bounds.second = in.get<T>();
+
+    m_population.resize(m_population_size);
+    for (auto& monkey : m_population) in.getPoints(monkey);
+    in.getVector(m_fitness);
+    in.getVector(m_group_id);
+    m_num_groups = in.get<int32_t>();
+
+    m_local_leaders.resize(m_num_groups);
+    for (auto& leader : m_local_leaders) in.getPoints(leader);
+    in.getVector(m_local_leader_fitness);
+    in.getVector(m_local_leader_exact);
+    in.getVector(m_local_leader_limit_count);
+
+    in.getPoints(m_global_leader);
+    m_global_leader_fitness = in.get<double>();
+    m_global_leader_limit_count = in.get<int32_t>();
+
+    if ((int)m_fitness.size() != m_population_size || (int)m_group_id.size() != m_population_size ||
+        (int)m_local_leader_fitness.size() != m_num_groups || (int)m_local_leader_exact.size() != m_num_groups ||
+        (int)m_local_leader_limit_count.size() != m_num_groups)
+        throw std::runtime_error("SMO checkpoint is inconsistent");
+    buildSample();
+    m_restored = true;
+}
+
+#define INSTANTIATE_SMO(M, T) template class SMO<M, T>;
+MTSP_FOR_EACH_POLICY(INSTANTIATE_SMO)
+#undef INSTANTIATE_SMO